@@ -41,6 +41,8 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "mm-gpio.h"
+
 // -----------------------------------------------------------------------------
 // prototypes
 
@@ -53,70 +55,97 @@ void digitalWrite(uint32_t *gpio, int pin, int value)
 {
 }
 
+/* ======================================================= */
+/* SECTION: generic pin configuration                      */
+/* ------------------------------------------------------- */
+
+// BCM pins 0..53, in 6 function-select registers of 10 pins each (3 bits per pin)
+#define MAX_PIN 53
+#define FSEL_REGS 6
+
+/* shadow copies of GPFSEL0..5 of the register block @shadowBase@; a register is read */
+/* once, and after that only written, as nothing else changes the pin functions      */
+static uint32_t fselShadow[FSEL_REGS];
+static int fselValid[FSEL_REGS];
+static uint32_t *shadowBase = NULL;
+
+/* set the function (0 = INPUT, 1 = OUTPUT, 2..7 = alternate) of any BCM pin; the */
+/* register is only written if that changes it                                    */
 void pinMode(uint32_t *gpio, int pin, int mode)
 {
-  int fsel, shift, res;
+  int fsel, shift;
+  uint32_t word;
 
-  switch (pin)
-  {
-  case LED:
-    fsel = 1;
-    shift = 9;
-    break;
-
-  case LED2:
-    fsel = 0;
-    shift = 15;
-    break;
-
-  case BUTTON:
-    fsel = 1;
-    shift = 27;
-    break;
-
-  default:
+  if (pin < 0 || pin > MAX_PIN)
     failure(TRUE, "pinMode: pin %d not supported\n", pin);
-    break;
+
+  fsel = pin / 10;
+  shift = (pin % 10) * 3;
+
+  if (gpio != shadowBase)
+  { // another register block: forget the shadow
+    for (int i = 0; i < FSEL_REGS; i++)
+      fselValid[i] = 0;
+    shadowBase = gpio;
+  }
+  if (!fselValid[fsel])
+  {
+    fselShadow[fsel] = *(volatile uint32_t *)(gpio + fsel);
+    fselValid[fsel] = 1;
   }
 
-  asm(
-      "\tB _bonzo0\n"
-      "_bonzo0:\n"
-      "\tLDR R1, %[gpio]\n"
-      "\tADD R0, R1, %[fsel]\n"
-      "\tLDR R1, [R0, #0]\n"
-      "\tMOV R2, #0b111\n"
-      "\tLSL R2, %[shift]\n"
-      "\tBIC R1, R1, R2\n"
-      "\tMOV R2, %[mode]\n"
-      "\tLSL R2, %[shift]\n"
-      "\tORR R1, R2\n"
-      "\tSTR R1, [R0, #0]\n"
-      "\tMOV %[result], R1\n"
-      : [result] "=r"(res)
-      : [act] "r"(pin), [gpio] "m"(gpio), [fsel] "r"(fsel * 4),
-        [shift] "r"(shift), [mode] "r"(mode)
-      : "r0", "r1", "r2", "cc");
+  word = (fselShadow[fsel] & ~(0b111u << shift)) | ((uint32_t)(mode & 0b111) << shift);
+  if (word == fselShadow[fsel])
+    return;
+  fselShadow[fsel] = word;
+
+#if defined(__arm__)
+  asm volatile(
+      "\tSTR %[word], [%[reg], #0]\n"
+      :
+      : [word] "r"(word), [reg] "r"(gpio + fsel)
+      : "memory");
+#else
+  *(volatile uint32_t *)(gpio + fsel) = word;
+#endif
+}
+
+/* ======================================================= */
+/* SECTION: LED, button                                    */
+/* ------------------------------------------------------- */
+
+/* set the pins in @setMask@ and clear those in @clearMask@ (BCM pins 0..31), with */
+/* one GPSET0 and one GPCLR0 store, so several LEDs change together                 */
+void writePins(uint32_t *gpio, uint32_t setMask, uint32_t clearMask)
+{
+#if defined(__arm__)
+  asm volatile(
+      "\tCMP %[set], #0\n"
+      "\tSTRNE %[set], [%[gpio], %[setOff]]\n"
+      "\tCMP %[clr], #0\n"
+      "\tSTRNE %[clr], [%[gpio], %[clrOff]]\n"
+      :
+      : [set] "r"(setMask), [clr] "r"(clearMask), [gpio] "r"(gpio), [setOff] "i"(GPSET0 * 4), [clrOff] "i"(GPCLR0 * 4)
+      : "cc", "memory");
+#else
+  if (setMask != 0)
+    *(volatile uint32_t *)(gpio + GPSET0) = setMask;
+  if (clearMask != 0)
+    *(volatile uint32_t *)(gpio + GPCLR0) = clearMask;
+#endif
 }
 
 void writeLED(uint32_t *gpio, int led, int value)
 {
   int off, res;
 
-  switch (led)
-  {
-  case LED:
-    off = (value == LOW) ? 10 : 7;
-    break;
-
-  case LED2:
-    off = (value == LOW) ? 10 : 7;
-    break;
-
-  default:
+  if (led < 0 || led > MAX_PIN)
     failure(TRUE, "writeLED: pin %d not supported\n", led);
-  }
 
+  // GPSET0/GPCLR0 for pins 0..31, GPSET1/GPCLR1 for the others
+  off = ((value == LOW) ? GPCLR0 : GPSET0) + led / 32;
+
+#if defined(__arm__)
   asm volatile(
       "\tB   _bonzo1\n"
       "_bonzo1:\n"
@@ -131,6 +160,10 @@ void writeLED(uint32_t *gpio, int led, int value)
       : [result] "=r"(res)
       : [led] "r"(led), [gpio] "m"(gpio), [off] "r"(off * 4)
       : "r0", "r1", "r2", "cc");
+#else
+  res = 1 << (led & 31);
+  *(volatile uint32_t *)(gpio + off) = res;
+#endif
 }
 
 int readButton(uint32_t *gpio, int button)
@@ -139,17 +172,13 @@ int readButton(uint32_t *gpio, int button)
   int res;
   int off;
 
-  switch (button)
-  {
-  case BUTTON:
-    off = 13;
-    break;
-
-  default:
+  if (button < 0 || button > MAX_PIN)
     failure(TRUE, "readButton: pin %d not supported\n", button);
-    break;
-  }
 
+  // GPLEV0 for pins 0..31, GPLEV1 for the others
+  off = GPLEV0 + button / 32;
+
+#if defined(__arm__)
   asm(
       "\tB   _bonzo2\n"
       "_bonzo2:\n"
@@ -165,6 +194,27 @@ int readButton(uint32_t *gpio, int button)
       : [result] "=r"(res)
       : [button] "r"(button), [gpio] "m"(gpio), [off] "r"(off * 4)
       : "r0", "r1", "r2", "cc");
+#else
+  res = *(volatile uint32_t *)(gpio + off) & (1 << (button & 31));
+#endif
+
+  return res;
+}
+
+/* read the levels of BCM pins 0..31 at once, from GPLEV0 */
+uint32_t readPins(uint32_t *gpio)
+{
+  uint32_t res;
+
+#if defined(__arm__)
+  asm volatile(
+      "\tLDR %[result], [%[gpio], %[levOff]]\n"
+      : [result] "=r"(res)
+      : [gpio] "r"(gpio), [levOff] "i"(GPLEV0 * 4)
+      : "memory");
+#else
+  res = *(volatile uint32_t *)(gpio + GPLEV0);
+#endif
 
   return res;
 }
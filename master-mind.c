@@ -62,6 +62,22 @@
 #include <sys/wait.h>
 #include <sys/ioctl.h>
 
+#include "mm-score.h"
+#include "mm-button.h"
+#include "mm-clock.h"
+#include "mm-decode.h"
+#include "mm-gpio.h"
+#include "mm-hint.h"
+#include "mm-index.h"
+#include "mm-input.h"
+#include "mm-lcd.h"
+#include "mm-led.h"
+#include "mm-pwm.h"
+#include "mm-rt.h"
+#include "mm-loop.h"
+#include "mm-sim.h"
+#include "mm-station.h"
+
 /* --------------------------------------------------------------------------- */
 /* Config settings */
 /* you can use CPP flags to e.g. print extra debugging messages */
@@ -87,7 +103,7 @@
 #define TIMEOUT 3000000
 // =======================================================
 // APP constants   ---------------------------------
-// number of colours and length of the sequence
+// default number of colours and length of the sequence; change with -c and -l
 #define COLS 3
 #define SEQL 3
 // =======================================================
@@ -114,10 +130,13 @@
 
 /* Constants */
 
-static const int colors = COLS;
-static const int seqlen = SEQL;
+static int colors = COLS;
+static int seqlen = SEQL;
+
+static char *color_names[MAX_COLS] = {"red", "green", "blue", "yellow", "white", "black", "orange", "purple", "pink"};
 
-static char *color_names[] = {"red", "green", "blue"};
+/* scoring kernel specialised to (colors, seqlen); bound in main via bindKernel() */
+static score_fn matchKernel = NULL;
 
 static int *theSeq = NULL;
 
@@ -130,10 +149,17 @@ static int *seq1, *seq2;
 
 #define PI_GPIO_MASK (0xFFFFFFC0)
 
-static unsigned int gpiobase;
 static uint32_t *gpio;
 
-static int timed_out = 0;
+/* time the game started waiting for a digit; sampled presses before it don't count */
+static uint64_t inputFrom = 0;
+/* the LED sequencer and the digit decoder of the player */
+static struct ledSeq leds;
+static struct decoder digitDecoder;
+/* the secrets still consistent with the feedback so far (option -H) */
+static struct hint hints;
+/* the inverted index it prunes through (option -X) */
+static struct codeIndex codeIdx;
 
 /* ------------------------------------------------------- */
 // misc prototypes
@@ -142,6 +168,16 @@ int failure(int fatal, const char *message, ...);
 void waitForEnter(void);
 void waitForButton(uint32_t *gpio, int button);
 
+/* score all pairs in file @path@ ("-" for stdin) and write the results to stdout; see mm-judge.c */
+long bulkJudge(const char *path, int binary, int len, int cols, score_fn kernel);
+
+/* run the cases in file @path@ against countMatches(); returns the number of failures; see mm-unit.c */
+int runUnitTests(const char *path, int *(*countMatches)(int *, int *), int len, int cols);
+
+/* serve games over the Unix socket @path@ until SIGINT/SIGTERM, scored by countMatches(), */
+/* with the secret @secret@ or random ones if it is NULL; see mm-server.c                  */
+int runServer(const char *path, int *(*countMatches)(int *, int *), int len, int cols, const int *secret);
+
 /* ======================================================= */
 /* SECTION: hardware interface (LED, button)  */
 /* ------------------------------------------------------- */
@@ -150,6 +186,9 @@ void waitForButton(uint32_t *gpio, int button);
 /* set the @mode@ of a GPIO @pin@ to INPUT or OUTPUT; @gpio@ is the mmaped GPIO base address */
 void pinMode(uint32_t *gpio, int pin, int mode);
 
+/* set the pins in @setMask@ and clear those in @clearMask@ (pins 0..31) with one store each */
+void writePins(uint32_t *gpio, uint32_t setMask, uint32_t clearMask);
+
 /* send a @value@ (LOW or HIGH) on pin number @pin@; @gpio@ is the mmaped GPIO base address */
 void writeLED(uint32_t *gpio, int led, int value);
 
@@ -173,7 +212,7 @@ void initSeq()
 
   for (int i = 0; i < seqlen; i++)
   {
-    theSeq[i] = (rand() % 3) + 1;
+    theSeq[i] = (rand() % colors) + 1;
   }
 }
 
@@ -194,145 +233,31 @@ void showSeq(int *seq)
 
 /* counts how many entries in seq2 match entries in seq1 */
 /* returns exact and approximate matches */
-/* as a pointer to a pair of values */
+/* as a pointer to a pair of values; the pair is owned by this fct, and */
+/* overwritten by the next call, so nothing is allocated per call       */
 int *countMatches(int *seq1, int *seq2)
 {
-  int *data = (int *)malloc(2 * sizeof(int)); // variable to store the matches
-
-  int res_exact = 0;
-  int res_approx = 0;
-
-  asm(
-      "start:\n"
-      "\tMOV R0, #0\n" // exact
-      "\tMOV R3, #0\n" // approx
-      "\tMOV R1, %[seq1]\n"
-      "\tMOV R2, %[seq2]\n"
-      "\tMOV R4, #0\n" // approx indicator
-      "\tMOV R5, #0\n" // length 1
-      "\tMOV R7, #0\n" // index 1
-      "\tMOV R6, #0\n" // length 2
-      "\tMOV R8, #0\n" // index 2
-      "\tB main_loop\n"
-
-      "main_loop:\n"
-      "\tCMP R5, #3\n"
-      "\tBEQ exit_routine\n"
-
-      "\tLDR R9, [R1, R7]\n"
-      "\tLDR R10, [R2, R7]\n"
-
-      "\tCMP R9, R10\n"
-      "\tBEQ add_exact\n"
-
-      "\tMOV R6, #0\n"
-      "\tMOV R8, #0\n"
-      "\rB approx_loop\n"
-      "\tB loop_increment1\n"
-
-      "loop_increment1:\n"
-      "\tADD R5, R5, #1\n"
-      "\tADD R7, R7, #4\n"
-      "\tB main_loop\n"
-
-      "add_exact:\n"
-      "\tADD R0, R0, #1\n"
-      "\tCMP R10, R4\n"
-      "\tBEQ check_approx_size\n"
-      "\tB loop_increment1\n"
-
-      "check_approx_size:\n"
-      "\tCMP R3, #0\n"
-      "\tBNE decrement_approx\n"
-      "\tB loop_increment1\n"
-
-      "decrement_approx:\n"
-      "\tSUB R3, R3, #1\n"
-      "\tB loop_increment1\n"
-
-      "approx_loop:\n"
-      "\tCMP R6, #3\n"
-      "\tBEQ loop_increment1\n"
-
-      "\tLDR R10, [R2, R8]\n"
-
-      "\tCMP R9, R10\n"
-      "\tBEQ index_check\n"
-      "\tB loop_increment2\n"
-
-      "loop_increment2:\n"
-      "\tADD R6, R6, #1\n"
-      "\tADD R8, R8, #4\n"
-      "\tB approx_loop\n"
-
-      "index_check:\n"
-      "\tCMP R5, R6\n"
-      "\tBNE approx_check\n"
-      "\tB loop_increment2\n"
-
-      "approx_check:\n"
-      "\tCMP R10, R4\n"
-      "\tBNE add_approx\n"
-      "\tB loop_increment2\n"
-
-      "add_approx:\n"
-      "\tMOV R4, R10\n"
-      "\tADD R3, R3, #1\n"
-      "\tMOV R6, #2\n"
-      "\tB loop_increment2\n"
-
-      "exit_routine:\n"
-      "\tMOV %[result_exact], R0\n"
-      "\tMOV %[result_approx], R3\n"
-
-      : [result_exact] "=r"(res_exact), [result_approx] "=r"(res_approx)
-      : [seq1] "r"(seq1), [seq2] "r"(seq2), [seqlen] "r"(seqlen)
-      : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "cc");
-
-  data[0] = res_exact;
-  data[1] = res_approx;
+  static int data[2];
+  struct matches res = matchKernel(seq1, seq2);
 
-  return data;
+  data[0] = res.exact;
+  data[1] = res.approx;
 
-  // int *data = (int *)malloc(2 * sizeof(int));
-
-  // data[0] = 0;
-  // data[1] = 0;
-
-  // int approx = 0;
-  // for (int i = 0; i < seqlen; i++)
-  // {
-  //   if (seq1[i] == seq2[i])
-  //   {
-  //     if (seq2[i] == approx && data[1] != 0)
-  //     {
-  //       data[1]--;
-  //     }
-  //     data[0]++;
-  //   }
-
-  //   else
-  //   {
-  //     for (int j = 0; j < seqlen; j++)
-  //     {
-  //       if (seq1[i] == seq2[j] && i != j && seq2[j] != approx)
-  //       {
-  //         approx = seq2[j];
-  //         data[1]++;
-  //       }
-  //     }
-  //   }
-  // }
-
-  // return data;
+  return data;
 }
 
-/* show the results from calling countMatches on seq1 and seq1 */
+/* show the results from calling countMatches on seq1 and seq1; */
+/* if @lcd_format@, also on the second row of the LCD           */
 void showMatches(int *code, int *seq1, int *seq2, int lcd_format)
 {
   code = countMatches(seq1, seq2); // calculating the matches
   fprintf(stdout, "%d exact\n", code[0]);
   fprintf(stdout, "%d approximate\n", code[1]);
+  if (lcd_format)
+  {
+    lcdPrintf(1, 0, "%d exact %d appr.%*s", code[0], code[1], LCD_COLS, ""); // blanks the rest, e.g. a hint
+    lcdRefresh();
+  }
 }
 
 /* parse an integer value as a list of digits, and put them into @seq@ */
@@ -350,6 +275,19 @@ void readSeq(int *seq, int val)
   }
 }
 
+/* readSeq() for a sequence given on the command line; exits unless @val@ has */
+/* seqlen digits, all colours 1..colors, as the kernels expect (see validSeq) */
+void readValidSeq(int *seq, int val)
+{
+  int limit = 1;
+
+  for (int i = 0; i < seqlen; i++)
+    limit *= 10;
+  readSeq(seq, val);
+  if (val < 0 || val >= limit || !validSeq(seq, seqlen, colors))
+    failure(TRUE, "Expected a sequence of %d digits 1..%d, not %d\n", seqlen, colors, val);
+}
+
 /* read a guess sequence fron stdin and store the values in arr */
 /* only needed for testing the game logic, without button input */
 int readNum(int max)
@@ -371,53 +309,29 @@ int readNum(int max)
 /* SECTION: TIMER code                                     */
 /* ------------------------------------------------------- */
 
-/* timestamps needed to implement a time-out mechanism */
-static uint64_t startT, stopT;
-
-/* you may need this function in timer_handler() below  */
-/* use the libc fct gettimeofday() to implement it      */
+/* all timing goes through the clock of mm-clock.c: CLOCK_MONOTONIC unless -V is given */
 uint64_t timeInMicroseconds()
 {
-  struct timeval tv;
-  uint64_t now;
-  gettimeofday(&tv, NULL);
-  now = (uint64_t)tv.tv_sec * (uint64_t)1000000 + (uint64_t)tv.tv_usec;
-  return (uint64_t)now;
-}
-
-/* this should be the callback, triggered via an interval timer, */
-/* that is set-up through a call to sigaction() in the main fct. */
-void timer_handler(int signum)
-{
-  static int count = 0;
-  stopT = timeInMicroseconds();
-  count++;
-  fprintf(stderr, "Timer expired %d times. Time took: %f\n", count, (stopT - startT) / 1000000.0);
-  timed_out = 1;
+  return clockNow();
 }
 
-/* initialise time-stamps, setup an interval timer, and install the timer_handler callback */
-void initITimer(uint64_t timeout)
+/* run the event loop until the digit being entered ends (see mm-decode.h): on an idle */
+/* gap after its last press, or on a long press; returns its number of presses        */
+int readDigit(void)
 {
-  struct sigaction sa;
-  struct itimerval timer;
+  uint64_t startT = timeInMicroseconds(), now, deadline;
+  int n;
 
-  /* setting the signale handler for when the timer expires */
-  memset(&sa, 0, sizeof(sa));
-  sa.sa_handler = &timer_handler;
-
-  sigaction(SIGALRM, &sa, NULL);
-
-  /* specifications for a non recurring timer */
-  timer.it_value.tv_sec = timeout;
-  timer.it_value.tv_usec = 0;
-
-  timer.it_interval.tv_sec = 0;
-  timer.it_interval.tv_usec = 0;
-
-  setitimer(ITIMER_REAL, &timer, NULL);
+  while (!decodeDone(&digitDecoder, now = timeInMicroseconds()))
+  {
+    deadline = decodeDeadline(&digitDecoder);
+    loopRunOnce(deadline == UINT64_MAX ? -1 : (int)((deadline - now + 999) / 1000));
+  }
+  n = decodeEnd(&digitDecoder, now);
+  fprintf(stderr, "Digit ended by %s. Time took: %f\n",
+          decodeLastEnd(&digitDecoder) == END_LONG ? "long press" : "gap", (now - startT) / 1000000.0);
 
-  startT = timeInMicroseconds();
+  return n;
 }
 
 /* ======================================================= */
@@ -461,12 +375,7 @@ void waitForEnter(void)
 
 void delay(unsigned int howLong)
 {
-  struct timespec sleeper, dummy;
-
-  sleeper.tv_sec = (time_t)(howLong / 1000);
-  sleeper.tv_nsec = (long)(howLong % 1000) * 1000000;
-
-  nanosleep(&sleeper, &dummy);
+  clockSleep((uint64_t)howLong * 1000);
 }
 
 /* From wiringPi code; comment by Gordon Henderson
@@ -489,10 +398,6 @@ void delay(unsigned int howLong)
 
 void delayMicroseconds(unsigned int howLong)
 {
-  struct timespec sleeper;
-  unsigned int uSecs = howLong % 1000000;
-  unsigned int wSecs = howLong / 1000000;
-
   /**/ if (howLong == 0)
     return;
 #if 0
@@ -500,11 +405,7 @@ void delayMicroseconds(unsigned int howLong)
     delayMicrosecondsHard (howLong) ;
 #endif
   else
-  {
-    sleeper.tv_sec = wSecs;
-    sleeper.tv_nsec = (long)(uSecs * 1000L);
-    nanosleep(&sleeper, NULL);
-  }
+    clockSleep(howLong);
 }
 
 /* ======================================================= */
@@ -513,20 +414,157 @@ void delayMicroseconds(unsigned int howLong)
 
 /* interface on top of the low-level pin I/O code */
 
+/* queue @c@ blinks of the led on pin @led@ with the LED sequencer @seq@, and return at */
+/* once; the blinks follow those queued before; see mm-led.c                           */
+void blinkAsync(struct ledSeq *seq, uint32_t *gpio, int led, int c)
+{
+  /* turns the led on and off with  certain delay, and pauses at the end */
+  ledEnqueue(seq, gpio, led, 700, 700, c);
+  ledEnqueue(seq, gpio, -1, 0, 500, 1);
+}
+
+/* how long the compact feedback shows, in milli-seconds */
+#define GLOW_MS 600
+
+/* PWM brightness for @n@ of seqlen matches; the square makes the steps look about even */
+static int matchLevel(int n)
+{
+  int level = PWM_LEVELS * n * n / (seqlen * seqlen);
+
+  return (n > 0 && level == 0) ? 1 : level;
+}
+
+/* queue the compact feedback (option -F pwm) on @seq@: @exact@ and @approx@ matches show */
+/* at once, for GLOW_MS, as the brightness of the green LED @green@ and the red LED @red@ */
+void glowAsync(struct ledSeq *seq, uint32_t *gpio, int green, int red, int exact, int approx)
+{
+  ledEnqueueLevel(seq, gpio, green, matchLevel(exact), 0);
+  ledEnqueueLevel(seq, gpio, red, matchLevel(approx), GLOW_MS);
+  ledEnqueueLevel(seq, gpio, green, 0, 0);
+  ledEnqueueLevel(seq, gpio, red, 0, 0);
+  ledEnqueue(seq, gpio, -1, 0, 500, 1);
+}
+
+/* print the number of secrets left and a suggested guess; on the LCD, the */
+/* suggestion goes below the digits of the guess, marked with '?'          */
+void showHint(struct hint *h)
+{
+  int guess[MAX_SEQL];
+
+  if (hintSuggest(h, guess) < 0)
+  {
+    fprintf(stdout, "Hint: no secret fits the feedback\n\n");
+    return;
+  }
+  fprintf(stdout, "Hint: %d possible secret%s, try", h->count, (h->count == 1) ? "" : "s");
+  for (int i = 0; i < h->len; i++)
+    fprintf(stdout, " %d", guess[i]);
+  fprintf(stdout, "\n\n");
+
+  lcdPrintf(1, 0, "%d", h->count);
+  lcdPrintf(1, LCD_COLS - 1 - h->len, "?");
+  for (int i = 0; i < h->len; i++)
+    lcdPrintf(1, LCD_COLS - h->len + i, "%d", guess[i]);
+}
+
+/* map the index in the file @path@, or build it and save it there if there is no */
+/* such file yet, or it holds the index of another configuration or is damaged;   */
+/* returns 0, or -1 if the code space is too large for an index                   */
+int openIndex(struct codeIndex *ix, const char *path)
+{
+  struct timespec t1, t2;
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  if (indexLoad(ix, path, seqlen, colors) == 0)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    fprintf(stderr, "index: mapped %s (%s, %.1f MB) in %.3f ms\n", path, ix->layout == INDEX_DENSE ? "dense" : "sparse",
+            ix->size / 1048576.0, (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6);
+    return 0;
+  }
+  if (errno == EINVAL)
+    fprintf(stderr, "index: %s is damaged, rebuilding it\n", path);
+  else if (errno != ENOENT && errno != ESTALE)
+    failure(TRUE, "index: Unable to map %s: %s\n", path, strerror(errno));
+
+  if (indexBuild(ix, seqlen, colors) != 0)
+  {
+    fprintf(stderr, "index: the code space of %d colours and length %d is too large for an index\n", colors, seqlen);
+    return -1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  fprintf(stderr, "index: built %s (%s, %.1f MB) in %.3f s\n", path, ix->layout == INDEX_DENSE ? "dense" : "sparse",
+          ix->size / 1048576.0, (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9);
+  if (indexSave(ix, path) != 0)
+    fprintf(stderr, "index: Unable to save %s: %s\n", path, strerror(errno));
+  return 0;
+}
+
 /* blink the led on pin @led@, @c@ times */
 void blinkN(uint32_t *gpio, int led, int c)
 {
-  /* ***  COMPLETE the code here  ***  */
-  for (int i = 0; i < c; i++)
+  blinkAsync(&leds, gpio, led, c);
+  ledWait(&leds);
+}
+
+/* handlers of the event loop that feed button presses to the digit decoder of mm-decode.c */
+
+static void countPress(uint64_t t)
+{
+  decodePress(&digitDecoder, t);
+  fprintf(stderr, "Button Pressed\n");
+}
+
+/* a press or release edge from the GPIO chip; the kernel stamps it on CLOCK_MONOTONIC */
+/* in ns, the real clock's base in us                                                  */
+static void onButtonEvent(void *arg)
+{
+  uint64_t ts, t;
+  int edge;
+
+  (void)arg;
+  if ((edge = buttonWaitEvent(0, &ts)) <= 0)
+    return;
+  t = (strcmp(clockName(), "real") == 0) ? ts / 1000 : timeInMicroseconds();
+  if (edge == 1 && t >= inputFrom)
+    countPress(t);
+  else if (edge == 2)
+    decodeRelease(&digitDecoder, t); // no-op unless a press counted
+}
+
+/* without edge events: presses and releases from the sampling thread of mm-input.c */
+static void onInputEvents(void *arg)
+{
+  struct inputEvent ev;
+
+  (void)arg;
+  while (inputPop(&ev))
   {
-    /* turns the led on and off with  certain delay */
-    writeLED(gpio, led, HIGH);
-    delay(700);
-    writeLED(gpio, led, LOW);
-    delay(700);
+    if (ev.pressed && ev.t >= inputFrom)
+      countPress(ev.t);
+    else if (!ev.pressed)
+      decodeRelease(&digitDecoder, ev.t);
   }
+}
+
+/* option -k: every line on stdin is a press */
+static void onKeyboard(void *arg)
+{
+  char buf[256];
+  ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
 
-  delay(500);
+  (void)arg;
+  if (n <= 0)
+  {
+    loopRemoveFd(STDIN_FILENO);
+    return;
+  }
+  for (ssize_t i = 0; i < n; i++)
+    if (buf[i] == '\n')
+    {
+      countPress(timeInMicroseconds());
+      decodeRelease(&digitDecoder, timeInMicroseconds());
+    }
 }
 
 /* ======================================================= */
@@ -540,11 +578,14 @@ int main(int argc, char *argv[])
   int *attSeq;
 
   int pinLED = LED, pin2LED2 = LED2, pinButton = BUTTON;
-  int fd;
 
   // variables for command-line processing
   char str_in[20], str[20] = "some text";
   int verbose = 0, debug = 0, help = 0, opt_m = 0, opt_n = 0, opt_s = 0, unit_test = 0;
+  int opt_B = 0, opt_V = 0, opt_k = 0, opt_r = SAMPLE_RATE, opt_R = 0, opt_j = 0, rtCPU = -1;
+  int opt_e = 0, opt_i = DIGIT_GAP_MS, opt_P = 0, opt_F_blink = 1, opt_N = 0, opt_H = 0, opt_L = 0;
+  char *opt_X = NULL;
+  char *opt_b = NULL, *opt_t = NULL, *opt_S = NULL, *opt_g = NULL, *opt_U = NULL;
 
   // -------------------------------------------------------
   // process command-line arguments
@@ -552,7 +593,7 @@ int main(int argc, char *argv[])
   // see: man 3 getopt for docu and an example of command line parsing
   { // see the CW spec for the intended meaning of these options
     int opt;
-    while ((opt = getopt(argc, argv, "hvdus:")) != -1)
+    while ((opt = getopt(argc, argv, "hvdVkjueHBLs:c:l:b:t:S:g:r:R:i:P:F:N:U:X:")) != -1)
     {
       switch (opt)
       {
@@ -565,14 +606,84 @@ int main(int argc, char *argv[])
       case 'd':
         debug = 1;
         break;
+      case 'V':
+        opt_V = 1;
+        break;
+      case 'k':
+        opt_k = 1;
+        break;
+      case 'r':
+        opt_r = atoi(optarg);
+        break;
+      case 'R':
+        opt_R = 1;
+        rtCPU = atoi(optarg);
+        break;
+      case 'j':
+        opt_j = 1;
+        break;
+      case 'e':
+        opt_e = 1;
+        break;
+      case 'i':
+        opt_i = atoi(optarg);
+        break;
+      case 'P':
+        opt_P = atoi(optarg);
+        break;
+      case 'H':
+        opt_H = 1;
+        break;
+      case 'X':
+        opt_X = optarg;
+        break;
+      case 'U':
+        opt_U = optarg;
+        break;
+      case 'N':
+        opt_N = atoi(optarg);
+        break;
+      case 'L':
+        opt_L = 1;
+        break;
+      case 'F':
+        if (strcmp(optarg, "pwm") == 0)
+          opt_F_blink = 0;
+        else if (strcmp(optarg, "blink") != 0)
+        {
+          fprintf(stderr, "Expected a feedback mode of blink or pwm\n");
+          exit(EXIT_FAILURE);
+        }
+        break;
       case 'u':
         unit_test = 1;
         break;
       case 's':
         opt_s = atoi(optarg);
         break;
+      case 'c':
+        colors = atoi(optarg);
+        break;
+      case 'l':
+        seqlen = atoi(optarg);
+        break;
+      case 'b':
+        opt_b = optarg;
+        break;
+      case 'B':
+        opt_B = 1;
+        break;
+      case 't':
+        opt_t = optarg;
+        break;
+      case 'S':
+        opt_S = optarg;
+        break;
+      case 'g':
+        opt_g = optarg;
+        break;
       default: /* '?' */
-        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-c <colours>] [-l <length>] [-u <seq1> <seq2>] [-b <pairs file> [-B]] [-t <case file>] [-g <gpio backend>] [-r <sample rate>] [-R <cpu>] [-j] [-k] [-i <gap ms>] [-P <long press ms>] [-e] [-F blink|pwm] [-L] [-H [-X <index file>]] [-N <stations>] [-U <socket>] [-S <script> [-V]] [-s <secret seq>]  \n", argv[0]);
         exit(EXIT_FAILURE);
       }
     }
@@ -583,10 +694,35 @@ int main(int argc, char *argv[])
     fprintf(stderr, "MasterMind program, running on a Raspberry Pi, with connected LED, button and LCD display\n");
     fprintf(stderr, "Use the button for input of numbers. The LCD display will show the matches with the secret sequence.\n");
     fprintf(stderr, "For full specification of the program see: https://www.macs.hw.ac.uk/~hwloidl/Courses/F28HS/F28HS_CW2_2022.pdf\n");
-    fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+    fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-c <colours>] [-l <length>] [-u <seq1> <seq2>] [-b <pairs file> [-B]] [-t <case file>] [-g <gpio backend>] [-r <sample rate>] [-R <cpu>] [-j] [-k] [-i <gap ms>] [-P <long press ms>] [-e] [-F blink|pwm] [-L] [-H [-X <index file>]] [-N <stations>] [-U <socket>] [-S <script> [-V]] [-s <secret seq>]  \n", argv[0]);
     exit(EXIT_SUCCESS);
   }
 
+  if (colors < 2 || colors > MAX_COLS || seqlen < 1 || seqlen > MAX_SEQL)
+  {
+    fprintf(stderr, "Expected 2..%d colours and a length of 1..%d\n", MAX_COLS, MAX_SEQL);
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_r < 1 || opt_r > 1000000)
+  {
+    fprintf(stderr, "Expected a sample rate of 1..1000000 Hz\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_N < 0 || opt_N > MAX_STATIONS)
+  {
+    fprintf(stderr, "Expected 1..%d stations\n", MAX_STATIONS);
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_i < 1 || opt_P < 0)
+  {
+    fprintf(stderr, "Expected a gap of at least 1 ms, and a long press of 0 (none) or more ms\n");
+    exit(EXIT_FAILURE);
+  }
+  decodeConfig((uint64_t)opt_i * 1000, (uint64_t)opt_P * 1000);
+
   if (unit_test && optind >= argc - 1)
   {
     fprintf(stderr, "Expected 2 arguments after option -u\n");
@@ -605,6 +741,7 @@ int main(int argc, char *argv[])
     fprintf(stdout, "Verbose is %s\n", (verbose ? "ON" : "OFF"));
     fprintf(stdout, "Debug is %s\n", (debug ? "ON" : "OFF"));
     fprintf(stdout, "Unittest is %s\n", (unit_test ? "ON" : "OFF"));
+    fprintf(stdout, "Playing with %d colours and sequences of length %d\n", colors, seqlen);
     if (opt_s)
       fprintf(stdout, "Secret sequence set to %d\n", opt_s);
   }
@@ -612,6 +749,26 @@ int main(int argc, char *argv[])
   seq1 = (int *)malloc(seqlen * sizeof(int));
   seq2 = (int *)malloc(seqlen * sizeof(int));
 
+  // check and time all scoring kernels for this configuration, and bind the fastest;
+  // this precomputes the feedback for every (secret, guess) pair, if the code space is small enough
+  // (set MM_KERNEL=<name> to force a kernel, and to see the timings)
+  matchKernel = bindKernel(seqlen, colors);
+  if (initMatchTable(seqlen, colors) != 0 && verbose)
+    fprintf(stdout, "Code space too large for a lookup table; scoring directly\n");
+
+  // check for -b option, and if so score all pairs in the given file (or stdin for "-")
+  if (opt_b != NULL)
+  {
+    long pairs = bulkJudge(opt_b, opt_B, seqlen, colors, matchKernel);
+    if (verbose)
+      fprintf(stderr, "Scored %ld pairs\n", pairs);
+    exit(EXIT_SUCCESS);
+  }
+
+  // check for -t option, and if so run all unit tests in the given case file
+  if (opt_t != NULL)
+    exit(runUnitTests(opt_t, countMatches, seqlen, colors) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
   // check for -u option, and if so run a unit test on the matching function
   if (unit_test && argc > optind + 1)
   { // more arguments to process; only needed with -u
@@ -620,8 +777,8 @@ int main(int argc, char *argv[])
     strcpy(str_in, argv[optind + 1]);
     opt_n = atoi(str_in);
     // CALL a test-matches function; see testm.c for an example implementation
-    readSeq(seq1, opt_m); // turn the integer number into a sequence of numbers
-    readSeq(seq2, opt_n); // turn the integer number into a sequence of numbers
+    readValidSeq(seq1, opt_m); // turn the integer number into a sequence of numbers
+    readValidSeq(seq2, opt_n); // turn the integer number into a sequence of numbers
     if (verbose)
       fprintf(stdout, "Testing matches function with sequences %d and %d\n", opt_m, opt_n);
     int *res_matches = countMatches(seq1, seq2);
@@ -637,7 +794,7 @@ int main(int argc, char *argv[])
   { // if -s option is given, use the sequence as secret sequence
     if (theSeq == NULL)
       theSeq = (int *)malloc(seqlen * sizeof(int));
-    readSeq(theSeq, opt_s);
+    readValidSeq(theSeq, opt_s);
     if (verbose)
     {
       fprintf(stderr, "Running program with secret sequence:\n");
@@ -645,24 +802,58 @@ int main(int argc, char *argv[])
     }
   }
 
-  if (geteuid() != 0)
-    fprintf(stderr, "setup: Must be root. (Did you forget sudo?)\n");
+  if (opt_U != NULL) // -U option: headless game server; no GPIO needed
+  {
+    if (!opt_s)
+      srand(time(0));
+    exit(runServer(opt_U, countMatches, seqlen, colors, opt_s ? theSeq : NULL) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
 
-  // -----------------------------------------------------------------------------
-  // constants for RPi2
-  gpiobase = 0x3F200000;
+  // -R option: real-time mode; memory locked, SCHED_FIFO, pinned to the given CPU (-1 for none);
+  // the threads started below inherit it (see mm-rt.h)
+  if (opt_R && rtSetup(rtCPU) != 0)
+    return failure(TRUE, "setup: Unable to enter real-time mode: %s\n", strerror(errno));
 
   // -----------------------------------------------------------------------------
-  // memory mapping
-  // Open the master /dev/memory device
+  // GPIO registers: mmap'ed from /dev/mem by default; -g sim[:<file>] simulates them (see mm-gpio.h)
+  // the -S script is played against simulated registers, unless another backend is given
 
-  if ((fd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC)) < 0)
-    return failure(FALSE, "setup: Unable to open /dev/mem: %s\n", strerror(errno));
+  if (opt_g == NULL)
+    opt_g = (opt_S != NULL) ? "sim" : "mem";
+
+  if ((gpio = gpioOpen(opt_g)) == NULL)
+    return failure(TRUE, "setup: Unable to map GPIO registers via backend %s: %s\n", opt_g, strerror(errno));
+  if (verbose)
+    fprintf(stdout, "GPIO backend is %s\n", gpioBackendName());
+
+  if (opt_S != NULL) // -S option: play the guesses of a script, and report latencies
+  {
+    if (opt_V) // -V option: in virtual time, i.e. as fast as the game logic runs
+      clockSelect("virtual");
+    if (opt_N > 0) // one player per station, on its button
+      for (int i = 0; i < opt_N; i++)
+        simPlay(opt_S, gpio, stationPins[i][2], DELAY);
+    else
+      simPlay(opt_S, gpio, pinButton, DELAY);
+  }
 
-  // GPIO:
-  gpio = (uint32_t *)mmap(0, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, gpiobase);
-  if ((int32_t)gpio == -1)
-    return failure(FALSE, "setup: mmap (GPIO) failed: %s\n", strerror(errno));
+  if (opt_N > 0) // -N option: several stations play at once, in one event loop (see mm-station.h)
+  {
+    struct stationConfig cfg = {gpio, seqlen, colors, matchKernel, opt_F_blink, opt_r};
+
+    if (!opt_F_blink && pwmStart(gpio) != 0)
+      return failure(TRUE, "setup: Unable to start the PWM thread: %s\n", strerror(errno));
+    if (!opt_s)
+      srand(time(0));
+    stationsRun(&cfg, opt_N, opt_s ? theSeq : NULL);
+
+    if (opt_j)
+      rtReport(stdout);
+    if (opt_e)
+      decodeReport(stdout);
+    gpioClose();
+    return 0;
+  }
 
   // -------------------------------------------------------
   // Configuration of LED and BUTTON
@@ -670,6 +861,29 @@ int main(int argc, char *argv[])
   pinMode(gpio, pinLED, OUTPUT);
   pinMode(gpio, pin2LED2, OUTPUT);
   pinMode(gpio, pinButton, INPUT);
+  writePins(gpio, 0, (1u << pinLED) | (1u << pin2LED2)); // both LEDs off
+
+  // the compact feedback drives the LEDs from a PWM thread
+  if (!opt_F_blink && pwmStart(gpio) != 0)
+    return failure(TRUE, "setup: Unable to start the PWM thread: %s\n", strerror(errno));
+
+  // the LCD shows round, guess and matches; with simulated registers, it is printed; on the
+  // hardware only with -L, as its pins (BCM 10 is SPI MOSI) may be wired to something else
+  if (strcmp(gpioBackendName(), "sim") == 0)
+    lcdOpen("sim", gpio);
+  else if (opt_L)
+    lcdOpen("gpio", gpio);
+
+  // on the hardware, take button presses as edge events from the GPIO chip if it provides them;
+  // otherwise (and with simulated registers) a thread samples the button's bit in GPLEV0 at -r Hz
+  if (strcmp(gpioBackendName(), "mem") == 0 && buttonEventsOpen(GPIO_CHIP, pinButton) != 0 && verbose)
+    fprintf(stdout, "No edge events from %s (%s); sampling the button\n", GPIO_CHIP, strerror(errno));
+  if (buttonEventsEnabled())
+    loopAddFd(buttonEventsFd(), onButtonEvent, NULL);
+  else if (inputStart(gpio, 1u << pinButton, opt_r, onInputEvents) != 0)
+    return failure(TRUE, "setup: Unable to start sampling the button: %s\n", strerror(errno));
+  if (opt_k) // -k option: the Enter key works as the button, too
+    loopAddFd(STDIN_FILENO, onKeyboard, NULL);
 
   // init of guess sequence, and copies (for use in countMatches)
   attSeq = (int *)malloc(seqlen * sizeof(int));
@@ -684,6 +898,14 @@ int main(int argc, char *argv[])
   if (debug)
     showSeq(theSeq);
 
+  if (opt_H && hintInit(&hints, seqlen, colors) != 0) // -H option: count the secrets left, and suggest a guess
+  {
+    fprintf(stderr, "hint: the code space of %d colours and length %d is too large for hints\n", colors, seqlen);
+    opt_H = 0;
+  }
+  if (opt_H && opt_X != NULL && openIndex(&codeIdx, opt_X) == 0) // -X option: prune through an inverted index
+    hintUseIndex(&hints, &codeIdx);
+
   // -----------------------------------------------------------------------------
   // +++++ main loop
 
@@ -693,53 +915,58 @@ int main(int argc, char *argv[])
   {
     attempts++;
 
-    blinkN(gpio, pin2LED2, 3);
+    /* the LED signals are queued, and play while the game goes on; see mm-led.c */
+    tracePhase(PH_ROUND);
+    blinkAsync(&leds, gpio, pin2LED2, 3);
     fprintf(stdout, "Round %d\n", attempts);
     printf("\n");
+    lcdClear();
+    lcdPrintf(0, 0, "Round %d", attempts);
+    lcdPrintf(0, LCD_COLS - 1 - seqlen, ":");
+    if (opt_H)
+      showHint(&hints);
+    lcdRefresh();
 
     /* defining the guess sequence numbers to calculate the input */
-    attSeq[0] = 0;
-    attSeq[1] = 0;
-    attSeq[2] = 0;
+    memset(attSeq, 0, seqlen * sizeof(int));
 
     for (int i = 0; i < seqlen; i++)
     {
-      /* Gets 3 numbers from the user to from the guess sequence */
-      waitForButton(gpio, pinButton);
-
-      timed_out = 0; // variable to indicate the timer
-      initITimer(5); // initilializing the timer
-
-      while (!timed_out)
+      /* Gets seqlen numbers from the user to form the guess sequence */
+      /* wait in the event loop for the first press: an edge event, a sampled press or a line on stdin */
+      decodeBegin(&digitDecoder);
+      inputFrom = timeInMicroseconds();
+      tracePhase(PH_WAIT);
+      while (decodePresses(&digitDecoder) == 0)
+        loopRunOnce(-1);
+      tracePhase(PH_INPUT);
+
+      /* gets input from the user until the button stays idle for the gap, or a press is held */
+      attSeq[i] = readDigit();
+
+      if (attSeq[i] > colors)
       {
-        /* gets input from the user until the timer expires */
-        if (readButton(gpio, pinButton) != 0)
-        {
-          attSeq[i]++;
-          fprintf(stderr, "Button Pressed\n");
-        }
-
-        delay(DELAY);
-      }
-
-      if (attSeq[i] > 3)
-      {
-        /* sets the number to 3 if the user pressed the button more than 3 times */
-        attSeq[i] = 3;
+        /* caps the number at the number of colours if the user pressed the button more often */
+        attSeq[i] = colors;
       }
 
       fprintf(stdout, "Input: %d\n", attSeq[i]); // prints the inputted number to the stdout
+      lcdPrintf(0, LCD_COLS - seqlen + i, "%d", attSeq[i]);
+      lcdRefresh();
 
-      blinkN(gpio, pin2LED2, 1);
-      blinkN(gpio, pinLED, attSeq[i]); // blinks the green led based on the input
+      tracePhase(PH_ECHO);
+      blinkAsync(&leds, gpio, pin2LED2, 1);
+      blinkAsync(&leds, gpio, pinLED, attSeq[i]); // blinks the green led based on the input
       fprintf(stdout, "\n");
     }
 
-    blinkN(gpio, pin2LED2, 2);
+    tracePhase(PH_INPUT_DONE);
+    blinkAsync(&leds, gpio, pin2LED2, 2);
 
+    tracePhase(PH_SCORE);
     result = countMatches(theSeq, attSeq); // calculates the exact and approximate matches
 
-    if (result[0] == 3)
+    if (result[0] == seqlen)
     {
       found = 1;
     }
@@ -747,25 +974,45 @@ int main(int argc, char *argv[])
     else if (attempts == 5)
     {
       /* exists the game after 5 rounds */
+      tracePhase(PH_DONE);
       break;
     }
 
     else
     {
+      /* the echo of the guess plays out first, so a round never queues more than its own */
+      /* steps, and the feedback is not lost behind a backlog                              */
+      ledWait(&leds);
+      tracePhase(PH_FEEDBACK); // the queue is empty, so the LEDs start on the feedback as it is queued
       showMatches(result, theSeq, attSeq, 1); // prints the exact and approximate matches to the stdout
       fprintf(stdout, "\n");
+      if (opt_H)
+      {
+        if (!hintConsistent(&hints, attSeq))
+          fprintf(stdout, "Hint: that guess could not have been the secret\n");
+        hintUpdate(&hints, attSeq, result[0], result[1]);
+      }
 
-      blinkN(gpio, pinLED, result[0]); // blinks the green led based on exact matches
-      blinkN(gpio, pin2LED2, 1);       // red led as separator
-      blinkN(gpio, pinLED, result[1]); // blinks the green led based on approximate matches
+      if (opt_F_blink)
+      {
+        blinkAsync(&leds, gpio, pinLED, result[0]); // blinks the green led based on exact matches
+        blinkAsync(&leds, gpio, pin2LED2, 1);       // red led as separator
+        blinkAsync(&leds, gpio, pinLED, result[1]); // blinks the green led based on approximate matches
+      }
+      else
+        glowAsync(&leds, gpio, pinLED, pin2LED2, result[0], result[1]); // exact on green, approximate on red
     }
+    tracePhase(PH_DONE);
   }
   if (found)
   {
 
     /* when the sequence is guessed correctly */
     fprintf(stdout, "Game completed in %d rounds\n", attempts);
+    lcdPrintf(1, 0, "%-*s", LCD_COLS, "SUCCESS");
+    lcdRefresh();
 
+    ledWait(&leds);
     writeLED(gpio, pin2LED2, HIGH);
     blinkN(gpio, pinLED, 3);
     writeLED(gpio, pin2LED2, LOW);
@@ -775,7 +1022,26 @@ int main(int argc, char *argv[])
   else
   {
     fprintf(stdout, "Sequence not found\n");
+    lcdPrintf(1, 0, "%-*s", LCD_COLS, "Not found");
+    lcdRefresh();
   }
+  ledWait(&leds);
+  writePins(gpio, 0, (1u << pinLED) | (1u << pin2LED2));
+  tracePhase(PH_END);
+
+  if (simEnabled)
+    simReport();
+  if (opt_j) // -j option: how late delays, timers and the sampler woke up
+    rtReport(stdout);
+  if (opt_e) // -e option: presses and gaps of every digit, to tune -i and -P
+    decodeReport(stdout);
+
+  if (opt_H)
+    hintFree(&hints);
+  if (codeIdx.mem != NULL)
+    indexFree(&codeIdx);
+  buttonEventsClose();
+  gpioClose();
   return 0;
 }
 
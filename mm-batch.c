@@ -0,0 +1,276 @@
+/* ***************************************************************************** */
+/* Batch scoring: one guess against a whole set of codes per call.               */
+/* The codes are stored as one byte per peg in structure-of-arrays layout, so a  */
+/* vector register holds the same peg of 16 (SSE2, NEON) or 32 (AVX2) codes.     */
+/* All kernels produce the packed feedback exact*(len+1)+approx of mm-score.h.   */
+/* ***************************************************************************** */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "mm-score.h"
+
+/* ======================================================= */
+/* SECTION: code sets                                      */
+/* ------------------------------------------------------- */
+
+struct codeSet *newCodeSet(int n, int len, int cols)
+{
+  struct codeSet *set = (struct codeSet *)malloc(sizeof(struct codeSet));
+
+  if (set == NULL)
+    return NULL;
+
+  set->n = n;
+  set->stride = (n + 31) & ~31;
+  set->len = len;
+  set->cols = cols;
+  set->pegs = (unsigned char *)aligned_alloc(32, (size_t)set->stride * len);
+  if (set->pegs == NULL)
+  {
+    free(set);
+    return NULL;
+  }
+  memset(set->pegs, 0, (size_t)set->stride * len);
+
+  return set;
+}
+
+void freeCodeSet(struct codeSet *set)
+{
+  if (set == NULL)
+    return;
+  free(set->pegs);
+  free(set);
+}
+
+void setCode(struct codeSet *set, int k, const int *seq)
+{
+  for (int p = 0; p < set->len; p++)
+    set->pegs[(size_t)p * set->stride + k] = (unsigned char)seq[p];
+}
+
+struct codeSet *codeSpaceSet(int len, int cols)
+{
+  int n = codeSpace(len, cols);
+  int seq[MAX_SEQL];
+  struct codeSet *set;
+
+  if (n < 0 || (set = newCodeSet(n, len, cols)) == NULL)
+    return NULL;
+
+  for (int k = 0; k < n; k++)
+  {
+    indexToSeq(seq, k, len, cols);
+    setCode(set, k, seq);
+  }
+
+  return set;
+}
+
+/* ======================================================= */
+/* SECTION: kernels                                        */
+/* ------------------------------------------------------- */
+
+/* Every kernel computes exact*len + common, which equals exact*(len+1)+approx */
+/* because common = exact + approx is the number of pegs the two codes share,  */
+/* i.e. the sum over all colours of the smaller count. Only colours that occur */
+/* in the guess can contribute, so those are collected once per call.          */
+static int guessColours(const int *guess, int len, unsigned char *col, unsigned char *cnt)
+{
+  int nc = 0;
+
+  for (int p = 0; p < len; p++)
+  {
+    int c = 0;
+    while (c < nc && col[c] != guess[p])
+      c++;
+    if (c == nc)
+    {
+      col[nc] = (unsigned char)guess[p];
+      cnt[nc++] = 0;
+    }
+    cnt[c]++;
+  }
+
+  return nc;
+}
+
+/* scalar scoring of codes @from@..@to@-1; the tail of every vector kernel */
+static void scoreRange(const int *guess, const struct codeSet *set, unsigned char *out, int from, int to,
+                       const unsigned char *col, const unsigned char *cnt, int nc)
+{
+  int len = set->len;
+
+  for (int k = from; k < to; k++)
+  {
+    int fb = 0;
+
+    for (int p = 0; p < len; p++)
+      fb += (set->pegs[(size_t)p * set->stride + k] == guess[p]) ? len : 0;
+
+    for (int c = 0; c < nc; c++)
+    {
+      int hits = 0;
+      for (int p = 0; p < len; p++)
+        hits += (set->pegs[(size_t)p * set->stride + k] == col[c]);
+      fb += (hits < cnt[c]) ? hits : cnt[c];
+    }
+
+    out[k] = (unsigned char)fb;
+  }
+}
+
+void countMatchesBatch_scalar(const int *guess, const struct codeSet *set, unsigned char *out)
+{
+  unsigned char col[MAX_SEQL], cnt[MAX_SEQL];
+  int nc = guessColours(guess, set->len, col, cnt);
+
+  scoreRange(guess, set, out, 0, set->n, col, cnt, nc);
+}
+
+#if defined(__x86_64__)
+void countMatchesBatch_sse2(const int *guess, const struct codeSet *set, unsigned char *out)
+{
+  unsigned char col[MAX_SEQL], cnt[MAX_SEQL];
+  int len = set->len, nc = guessColours(guess, len, col, cnt);
+  const __m128i weight = _mm_set1_epi8((char)len);
+  int k;
+
+  for (k = 0; k + 16 <= set->n; k += 16)
+  {
+    __m128i peg[MAX_SEQL];
+    __m128i fb = _mm_setzero_si128();
+
+    for (int p = 0; p < len; p++)
+    {
+      peg[p] = _mm_load_si128((const __m128i *)(set->pegs + (size_t)p * set->stride + k));
+      __m128i eq = _mm_cmpeq_epi8(peg[p], _mm_set1_epi8((char)guess[p]));
+      fb = _mm_add_epi8(fb, _mm_and_si128(eq, weight));
+    }
+
+    for (int c = 0; c < nc; c++)
+    {
+      __m128i colour = _mm_set1_epi8((char)col[c]);
+      __m128i hits = _mm_setzero_si128();
+      for (int p = 0; p < len; p++)
+        hits = _mm_sub_epi8(hits, _mm_cmpeq_epi8(peg[p], colour));
+      fb = _mm_add_epi8(fb, _mm_min_epu8(hits, _mm_set1_epi8((char)cnt[c])));
+    }
+
+    _mm_storeu_si128((__m128i *)(out + k), fb);
+  }
+
+  scoreRange(guess, set, out, k, set->n, col, cnt, nc);
+}
+
+__attribute__((target("avx2"))) void countMatchesBatch_avx2(const int *guess, const struct codeSet *set, unsigned char *out)
+{
+  unsigned char col[MAX_SEQL], cnt[MAX_SEQL];
+  int len = set->len, nc = guessColours(guess, len, col, cnt);
+  const __m256i weight = _mm256_set1_epi8((char)len);
+  int k;
+
+  for (k = 0; k + 32 <= set->n; k += 32)
+  {
+    __m256i peg[MAX_SEQL];
+    __m256i fb = _mm256_setzero_si256();
+
+    for (int p = 0; p < len; p++)
+    {
+      peg[p] = _mm256_load_si256((const __m256i *)(set->pegs + (size_t)p * set->stride + k));
+      __m256i eq = _mm256_cmpeq_epi8(peg[p], _mm256_set1_epi8((char)guess[p]));
+      fb = _mm256_add_epi8(fb, _mm256_and_si256(eq, weight));
+    }
+
+    for (int c = 0; c < nc; c++)
+    {
+      __m256i colour = _mm256_set1_epi8((char)col[c]);
+      __m256i hits = _mm256_setzero_si256();
+      for (int p = 0; p < len; p++)
+        hits = _mm256_sub_epi8(hits, _mm256_cmpeq_epi8(peg[p], colour));
+      fb = _mm256_add_epi8(fb, _mm256_min_epu8(hits, _mm256_set1_epi8((char)cnt[c])));
+    }
+
+    _mm256_storeu_si256((__m256i *)(out + k), fb);
+  }
+
+  scoreRange(guess, set, out, k, set->n, col, cnt, nc);
+}
+#endif
+
+#if defined(__ARM_NEON)
+void countMatchesBatch_neon(const int *guess, const struct codeSet *set, unsigned char *out)
+{
+  unsigned char col[MAX_SEQL], cnt[MAX_SEQL];
+  int len = set->len, nc = guessColours(guess, len, col, cnt);
+  const uint8x16_t weight = vdupq_n_u8((uint8_t)len);
+  int k;
+
+  for (k = 0; k + 16 <= set->n; k += 16)
+  {
+    uint8x16_t peg[MAX_SEQL];
+    uint8x16_t fb = vdupq_n_u8(0);
+
+    for (int p = 0; p < len; p++)
+    {
+      peg[p] = vld1q_u8(set->pegs + (size_t)p * set->stride + k);
+      uint8x16_t eq = vceqq_u8(peg[p], vdupq_n_u8((uint8_t)guess[p]));
+      fb = vaddq_u8(fb, vandq_u8(eq, weight));
+    }
+
+    for (int c = 0; c < nc; c++)
+    {
+      uint8x16_t colour = vdupq_n_u8(col[c]);
+      uint8x16_t hits = vdupq_n_u8(0);
+      for (int p = 0; p < len; p++)
+        hits = vsubq_u8(hits, vceqq_u8(peg[p], colour));
+      fb = vaddq_u8(fb, vminq_u8(hits, vdupq_n_u8(cnt[c])));
+    }
+
+    vst1q_u8(out + k, fb);
+  }
+
+  scoreRange(guess, set, out, k, set->n, col, cnt, nc);
+}
+#endif
+
+/* ======================================================= */
+/* SECTION: dispatch                                       */
+/* ------------------------------------------------------- */
+
+batch_fn selectBatchKernel(void)
+{
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return countMatchesBatch_avx2;
+  return countMatchesBatch_sse2;
+#elif defined(__ARM_NEON)
+  return countMatchesBatch_neon;
+#else
+  return countMatchesBatch_scalar;
+#endif
+}
+
+static batch_fn batchKernel = NULL;
+
+void setBatchKernel(batch_fn kernel)
+{
+  batchKernel = kernel;
+}
+
+void countMatchesBatch(const int *guess, const struct codeSet *set, unsigned char *out)
+{
+  if (batchKernel == NULL)
+    batchKernel = selectBatchKernel();
+
+  batchKernel(guess, set, out);
+}
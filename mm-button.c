@@ -0,0 +1,103 @@
+/* ***************************************************************************** */
+/* Button input from GPIO edge events via the v2 GPIO character-device ABI;      */
+/* see mm-button.h.                                                              */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "mm-button.h"
+
+static int lineFd = -1;
+
+#if defined(GPIO_V2_GET_LINE_IOCTL)
+
+int buttonEventsOpen(const char *chip, int line)
+{
+  struct gpio_v2_line_request req;
+  int fd, err;
+
+  if ((fd = open(chip, O_RDONLY | O_CLOEXEC)) < 0)
+    return -1;
+
+  memset(&req, 0, sizeof(req));
+  req.offsets[0] = line;
+  req.num_lines = 1;
+  strncpy(req.consumer, "master-mind", sizeof(req.consumer) - 1);
+  req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  // debounce in the kernel, so presses and releases alternate
+  req.config.num_attrs = 1;
+  req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+  req.config.attrs[0].attr.debounce_period_us = DEBOUNCE_US;
+  req.config.attrs[0].mask = 1;
+
+  err = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req);
+  close(fd);
+  if (err < 0)
+    return -1;
+
+  lineFd = req.fd;
+  return 0;
+}
+
+int buttonWaitEvent(int timeoutMs, uint64_t *ts)
+{
+  struct pollfd pfd = {lineFd, POLLIN, 0};
+  struct gpio_v2_line_event ev;
+  int n;
+
+  if ((n = poll(&pfd, 1, timeoutMs)) <= 0)
+    return (n < 0 && errno == EINTR) ? -1 : 0;
+
+  if (read(lineFd, &ev, sizeof(ev)) != (ssize_t)sizeof(ev))
+    return (errno == EINTR) ? -1 : 0;
+  if (ts != NULL)
+    *ts = ev.timestamp_ns;
+
+  return (ev.id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 2;
+}
+
+#else
+
+int buttonEventsOpen(const char *chip, int line)
+{
+  (void)chip;
+  (void)line;
+  errno = ENOSYS;
+  return -1;
+}
+
+int buttonWaitEvent(int timeoutMs, uint64_t *ts)
+{
+  (void)timeoutMs;
+  (void)ts;
+  return 0;
+}
+
+#endif
+
+int buttonEventsEnabled(void)
+{
+  return lineFd >= 0;
+}
+
+int buttonEventsFd(void)
+{
+  return lineFd;
+}
+
+void buttonEventsClose(void)
+{
+  if (lineFd < 0)
+    return;
+  close(lineFd);
+  lineFd = -1;
+}
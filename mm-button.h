@@ -0,0 +1,36 @@
+/* ***************************************************************************** */
+/* Button input from GPIO character-device edge events (/dev/gpiochipN), with   */
+/* kernel time-stamps, waited on with poll(); no CPU is used while waiting.      */
+/* Used when the registers come from /dev/mem; otherwise, or if the chip can't   */
+/* deliver events, the game polls the mmap'ed GPLEV0 register as before.        */
+/* ***************************************************************************** */
+
+#ifndef MM_BUTTON_H
+#define MM_BUTTON_H
+
+#include <stdint.h>
+
+// GPIO chip whose line offsets are the BCM pin numbers
+#define GPIO_CHIP "/dev/gpiochip0"
+// presses closer together than this are contact bounce, in micro-seconds
+#define DEBOUNCE_US 10000
+
+/* request the edge events of @line@ on @chip@, both presses (rising) and releases */
+/* (falling); returns 0, or -1 with errno set                                      */
+int buttonEventsOpen(const char *chip, int line);
+
+/* non-zero if edge events are in use */
+int buttonEventsEnabled(void);
+
+/* descriptor that is readable when a press is pending, for poll/epoll; -1 if not in use */
+int buttonEventsFd(void);
+
+/* wait up to @timeoutMs@ milli-seconds (-1 for ever) for the next edge; returns */
+/* 1 for a press, 2 for a release and, unless @ts@ is NULL, the CLOCK_MONOTONIC  */
+/* time-stamp of the edge in ns; 0 on time-out, or -1 if interrupted by a signal */
+int buttonWaitEvent(int timeoutMs, uint64_t *ts);
+
+/* release the line */
+void buttonEventsClose(void);
+
+#endif
@@ -0,0 +1,243 @@
+/* ***************************************************************************** */
+/* Real and virtual clocks; see mm-clock.h.                                      */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mm-clock.h"
+#include "mm-rt.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+// largest number of pending events
+#define MAX_EVENTS 256
+
+int failure(int fatal, const char *message, ...);
+
+/* ======================================================= */
+/* SECTION: event queue                                    */
+/* ------------------------------------------------------- */
+
+struct event
+{
+  uint64_t t;
+  event_fn fn;
+  void *arg;
+};
+
+/* pending events, sorted by time; events at the same time stay in the order they were added */
+static struct event queue[MAX_EVENTS];
+static int nqueue = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueCond; // on CLOCK_MONOTONIC, set up with the event thread
+
+/* add an event; the caller holds queueLock */
+static void pushEvent(uint64_t t, event_fn fn, void *arg)
+{
+  int i = nqueue;
+
+  if (nqueue == MAX_EVENTS)
+    failure(TRUE, "clock: more than %d pending events\n", MAX_EVENTS);
+
+  while (i > 0 && queue[i - 1].t > t)
+  {
+    queue[i] = queue[i - 1];
+    i--;
+  }
+  queue[i].t = t;
+  queue[i].fn = fn;
+  queue[i].arg = arg;
+  nqueue++;
+}
+
+/* remove the first event; the caller holds queueLock */
+static struct event popEvent(void)
+{
+  struct event e = queue[0];
+
+  memmove(queue, queue + 1, (size_t)(--nqueue) * sizeof(struct event));
+  return e;
+}
+
+/* ======================================================= */
+/* SECTION: real clock                                     */
+/* ------------------------------------------------------- */
+
+/* CLOCK_MONOTONIC: a step of the wall clock (NTP, settime) moves no deadline */
+static uint64_t realNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * (uint64_t)1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void realSleep(uint64_t us)
+{
+  struct timespec sleeper, t1, t2;
+
+  sleeper.tv_sec = (time_t)(us / 1000000);
+  sleeper.tv_nsec = (long)(us % 1000000) * 1000;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  nanosleep(&sleeper, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  rtRecordWake(WAKE_SLEEP, (int64_t)(t2.tv_sec - t1.tv_sec) * 1000000000 + (t2.tv_nsec - t1.tv_nsec) - (int64_t)us * 1000);
+}
+
+/* runs the events of the real clock when they fall due */
+static void *dispatcher(void *arg)
+{
+  sigset_t all;
+
+  (void)arg;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL); // signals are for the game loop
+  rtPlainThread();                        // it only plays the simulated player
+
+  pthread_mutex_lock(&queueLock);
+  for (;;)
+  {
+    if (nqueue == 0)
+    {
+      pthread_cond_wait(&queueCond, &queueLock);
+      continue;
+    }
+
+    uint64_t now = realNow();
+    if (queue[0].t > now)
+    { // the condition variable waits on CLOCK_MONOTONIC, as realNow() reads it
+      struct timespec until;
+      until.tv_sec = (time_t)(queue[0].t / 1000000);
+      until.tv_nsec = (long)(queue[0].t % 1000000) * 1000;
+      pthread_cond_timedwait(&queueCond, &queueLock, &until);
+      continue;
+    }
+
+    struct event e = popEvent();
+    pthread_mutex_unlock(&queueLock);
+    e.fn(e.arg);
+    pthread_mutex_lock(&queueLock);
+  }
+
+  return NULL;
+}
+
+static void realAt(uint64_t t, event_fn fn, void *arg)
+{
+  static int started = 0;
+  pthread_t thread;
+
+  pthread_mutex_lock(&queueLock);
+  if (!started)
+  {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queueCond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&thread, NULL, dispatcher, NULL) != 0)
+      failure(TRUE, "clock: unable to start the event thread\n");
+    pthread_detach(thread);
+    started = 1;
+  }
+  pushEvent(t, fn, arg);
+  pthread_cond_signal(&queueCond);
+  pthread_mutex_unlock(&queueLock);
+}
+
+/* ======================================================= */
+/* SECTION: virtual clock                                  */
+/* ------------------------------------------------------- */
+
+static uint64_t virtualTime = 0;
+
+static uint64_t virtualNow(void)
+{
+  return virtualTime;
+}
+
+/* advance to now+@us@, firing the events due up to then in time order */
+static void virtualSleep(uint64_t us)
+{
+  uint64_t target = virtualTime + us;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&queueLock);
+    if (nqueue == 0 || queue[0].t > target)
+    {
+      pthread_mutex_unlock(&queueLock);
+      break;
+    }
+    struct event e = popEvent();
+    pthread_mutex_unlock(&queueLock);
+    if (e.t > virtualTime)
+      virtualTime = e.t;
+    e.fn(e.arg);
+  }
+
+  virtualTime = target;
+}
+
+static void virtualAt(uint64_t t, event_fn fn, void *arg)
+{
+  pthread_mutex_lock(&queueLock);
+  pushEvent(t, fn, arg);
+  pthread_mutex_unlock(&queueLock);
+}
+
+/* ======================================================= */
+/* SECTION: selection                                      */
+/* ------------------------------------------------------- */
+
+static const struct clockOps clocks[] = {
+    {"real", realNow, realSleep, realAt},
+    {"virtual", virtualNow, virtualSleep, virtualAt},
+};
+
+static const struct clockOps *current = &clocks[0];
+
+int clockSelect(const char *name)
+{
+  for (size_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+  {
+    if (strcmp(name, clocks[i].name) == 0)
+    {
+      current = &clocks[i];
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+const char *clockName(void)
+{
+  return current->name;
+}
+
+uint64_t clockNow(void)
+{
+  return current->now();
+}
+
+void clockSleep(uint64_t us)
+{
+  current->sleep(us);
+}
+
+void clockAt(uint64_t t, event_fn fn, void *arg)
+{
+  current->at(t, fn, arg);
+}
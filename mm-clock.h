@@ -0,0 +1,47 @@
+/* ***************************************************************************** */
+/* Clocks behind all timing of the game loop (delays, the timers of mm-loop.c,  */
+/* time stamps), see option -V.                                                  */
+/*                                                                               */
+/*   real      CLOCK_MONOTONIC and nanosleep; unaffected by steps of the wall    */
+/*             clock, and the time base of the kernel's GPIO edge timestamps     */
+/*   virtual   discrete-event time: sleeping advances the clock at once, firing  */
+/*             the scheduled events that fall due on the way, in order           */
+/*                                                                               */
+/* Both run the same control flow; the virtual clock only makes sense with       */
+/* simulated hardware, whose events are scheduled with clockAt().                */
+/* ***************************************************************************** */
+
+#ifndef MM_CLOCK_H
+#define MM_CLOCK_H
+
+#include <stdint.h>
+
+/* scheduled event */
+typedef void (*event_fn)(void *arg);
+
+/* a clock; all times in micro-seconds */
+struct clockOps
+{
+  const char *name;
+  uint64_t (*now)(void);
+  void (*sleep)(uint64_t us);
+  void (*at)(uint64_t t, event_fn fn, void *arg);
+};
+
+/* use the clock named @name@ from now on; returns 0, or -1 if there is no such clock */
+int clockSelect(const char *name);
+
+/* name of the clock in use */
+const char *clockName(void);
+
+/* current time */
+uint64_t clockNow(void);
+
+/* sleep for @us@ */
+void clockSleep(uint64_t us);
+
+/* call @fn@(@arg@) at time @t@ (or at once if that has passed); with the real     */
+/* clock it runs on a separate thread, with the virtual one inside clockSleep()   */
+void clockAt(uint64_t t, event_fn fn, void *arg);
+
+#endif
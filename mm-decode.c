@@ -0,0 +1,137 @@
+/* ***************************************************************************** */
+/* Digit entry decoder on press/release time-stamps; see mm-decode.h.            */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-decode.h"
+
+static const char *endNames[END_COUNT] = {"gap", "long press"};
+
+static uint64_t gapLimit = (uint64_t)DIGIT_GAP_MS * 1000, longLimit = 0;
+
+static struct digitStats digits[MAX_DIGITS];
+static int ndigits = 0;
+
+/* ======================================================= */
+/* SECTION: decoder                                        */
+/* ------------------------------------------------------- */
+
+void decodeConfig(uint64_t gapUs, uint64_t longUs)
+{
+  gapLimit = gapUs;
+  longLimit = longUs;
+}
+
+void decodeBegin(struct decoder *d)
+{
+  d->presses = 0;
+  d->held = 0; // the release of a long press that ended the last digit is ignored
+  memset(&d->cur, 0, sizeof(d->cur));
+}
+
+void decodePress(struct decoder *d, uint64_t t)
+{
+  if (d->held)
+    return;
+
+  if (d->presses == 0)
+    d->firstPress = t;
+  else
+  {
+    uint64_t gap = t - d->lastPress;
+    d->cur.gapSum += gap;
+    if (gap > d->cur.gapMax)
+      d->cur.gapMax = gap;
+  }
+  d->presses++;
+  d->lastPress = t;
+  d->held = 1;
+}
+
+void decodeRelease(struct decoder *d, uint64_t t)
+{
+  if (!d->held)
+    return;
+
+  d->held = 0;
+  d->lastRelease = t;
+  if (t - d->lastPress > d->cur.holdMax)
+    d->cur.holdMax = t - d->lastPress;
+}
+
+int decodePresses(struct decoder *d)
+{
+  return d->presses;
+}
+
+uint64_t decodeDeadline(struct decoder *d)
+{
+  if (d->presses == 0)
+    return UINT64_MAX;
+  if (d->held)
+    return (longLimit != 0) ? d->lastPress + longLimit : UINT64_MAX;
+  return d->lastRelease + gapLimit;
+}
+
+int decodeDone(struct decoder *d, uint64_t now)
+{
+  return d->presses > 0 && now >= decodeDeadline(d);
+}
+
+int decodeEnd(struct decoder *d, uint64_t now)
+{
+  struct digitStats *c = &d->cur;
+
+  c->station = d->station;
+  c->presses = d->presses;
+  c->duration = now - d->firstPress;
+  c->end = d->held ? END_LONG : END_GAP;
+  c->idle = d->held ? 0 : now - d->lastRelease;
+  if (d->held && now - d->lastPress > c->holdMax)
+    c->holdMax = now - d->lastPress;
+
+  if (ndigits < MAX_DIGITS)
+    digits[ndigits++] = *c;
+
+  return d->presses;
+}
+
+enum digitEnd decodeLastEnd(struct decoder *d)
+{
+  return d->cur.end;
+}
+
+/* ======================================================= */
+/* SECTION: statistics                                     */
+/* ------------------------------------------------------- */
+
+void decodeReport(FILE *out)
+{
+  uint64_t gapMax = 0, holdMax = 0, durSum = 0;
+
+  fprintf(out, "\ndigit entry (gap %.0fms, long press %s)\n", gapLimit / 1e3, longLimit ? "on" : "off");
+  fprintf(out, "stn digit presses   duration   mean gap    max gap   max hold       idle  ended by\n");
+  for (int i = 0; i < ndigits; i++)
+  {
+    const struct digitStats *d = &digits[i];
+    double gapMean = (d->presses > 1) ? d->gapSum / 1e3 / (d->presses - 1) : 0;
+
+    fprintf(out, "%3d %5d %7d %8.1fms %8.1fms %8.1fms %8.1fms %8.1fms  %s\n", d->station + 1, i + 1, d->presses,
+            d->duration / 1e3, gapMean, d->gapMax / 1e3, d->holdMax / 1e3, d->idle / 1e3, endNames[d->end]);
+    if (d->gapMax > gapMax)
+      gapMax = d->gapMax;
+    if (d->holdMax > holdMax && d->end == END_GAP)
+      holdMax = d->holdMax;
+    durSum += d->duration;
+  }
+  if (ndigits == 0)
+    return;
+
+  // the gap must stay above the slowest presses within a digit, the long press above the longest normal one
+  fprintf(out, "mean digit %.1fms; longest gap within a digit %.1fms, longest ordinary press %.1fms\n",
+          durSum / 1e3 / ndigits, gapMax / 1e3, holdMax / 1e3);
+}
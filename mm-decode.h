@@ -0,0 +1,78 @@
+/* ***************************************************************************** */
+/* Digit entry from press/release time-stamps: a digit is the number of presses  */
+/* until the button has been idle for a gap (option -i), or until a press is     */
+/* held down long enough to commit the digit (option -P; it counts as a press).  */
+/* The presses and gaps of every digit are kept, to tune both thresholds from    */
+/* real play (option -e prints them).                                            */
+/* ***************************************************************************** */
+
+#ifndef MM_DECODE_H
+#define MM_DECODE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// default idle gap that ends a digit, in milli-seconds
+#define DIGIT_GAP_MS 1000
+// largest number of digits whose statistics are kept
+#define MAX_DIGITS 64
+
+/* how a digit ended */
+enum digitEnd
+{
+  END_GAP,  // no press for the idle gap
+  END_LONG, // the last press was held down for the long-press time
+  END_COUNT
+};
+
+/* statistics of a digit; times in micro-seconds */
+struct digitStats
+{
+  int station; // the decoder's
+  int presses;
+  uint64_t duration;       // first press to the end of the digit
+  uint64_t gapSum, gapMax; // between consecutive presses
+  uint64_t holdMax;        // longest press, press to release
+  uint64_t idle;           // last release to the end of the digit
+  enum digitEnd end;
+};
+
+/* the decoder of one button; zero-initialised, it belongs to station 0 */
+struct decoder
+{
+  int station;
+  int presses, held;
+  uint64_t firstPress, lastPress, lastRelease;
+  struct digitStats cur;
+};
+
+/* set the idle gap and the long-press time (0 for none) of all decoders, in micro-seconds */
+void decodeConfig(uint64_t gapUs, uint64_t longUs);
+
+/* start a new digit on @d@ */
+void decodeBegin(struct decoder *d);
+
+/* feed a press or release of @d@'s button at time @t@ of the clock */
+void decodePress(struct decoder *d, uint64_t t);
+void decodeRelease(struct decoder *d, uint64_t t);
+
+/* number of presses of the current digit so far */
+int decodePresses(struct decoder *d);
+
+/* non-zero if the current digit has ended by time @now@ */
+int decodeDone(struct decoder *d, uint64_t now);
+
+/* time at which the current digit ends unless the button is touched again */
+uint64_t decodeDeadline(struct decoder *d);
+
+/* finish the current digit at time @now@ and record its statistics; */
+/* returns its number of presses                                      */
+int decodeEnd(struct decoder *d, uint64_t now);
+
+/* how the last digit of @d@ ended */
+enum digitEnd decodeLastEnd(struct decoder *d);
+
+/* print the statistics of the digits of all decoders to @out@ */
+void decodeReport(FILE *out);
+
+#endif
@@ -0,0 +1,122 @@
+/* ***************************************************************************** */
+/* GPIO backends: the mmap'ed hardware registers, and a memory-backed simulator  */
+/* with the same register layout; see mm-gpio.h.                                 */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "mm-gpio.h"
+
+// length of the backend name in a spec
+#define MAX_NAME 16
+
+/* ======================================================= */
+/* SECTION: hardware                                       */
+/* ------------------------------------------------------- */
+
+static uint32_t *memMap(const char *arg)
+{
+  unsigned long base = (arg != NULL) ? strtoul(arg, NULL, 0) : GPIO_BASE;
+  uint32_t *regs;
+  int fd;
+
+  if (geteuid() != 0)
+    fprintf(stderr, "setup: Must be root. (Did you forget sudo?)\n");
+
+  // Open the master /dev/memory device
+  if ((fd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC)) < 0)
+    return NULL;
+
+  regs = (uint32_t *)mmap(0, GPIO_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, base);
+  close(fd);
+
+  return (regs == MAP_FAILED) ? NULL : regs;
+}
+
+/* ======================================================= */
+/* SECTION: simulator                                      */
+/* ------------------------------------------------------- */
+
+static uint32_t *simMap(const char *arg)
+{
+  uint32_t *regs;
+  int fd;
+
+  if (arg == NULL || *arg == '\0')
+  { // private to this process
+    regs = (uint32_t *)mmap(0, GPIO_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return (regs == MAP_FAILED) ? NULL : regs;
+  }
+
+  // shared through a file; keep its contents, so a script may set the button before the game starts
+  if ((fd = open(arg, O_RDWR | O_CREAT | O_CLOEXEC, 0666)) < 0)
+    return NULL;
+  if (ftruncate(fd, GPIO_BLOCK_SIZE) != 0)
+  {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return NULL;
+  }
+
+  regs = (uint32_t *)mmap(0, GPIO_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  return (regs == MAP_FAILED) ? NULL : regs;
+}
+
+static void unmapBlock(uint32_t *regs)
+{
+  munmap(regs, GPIO_BLOCK_SIZE);
+}
+
+/* ======================================================= */
+/* SECTION: selection                                      */
+/* ------------------------------------------------------- */
+
+static const struct gpioBackend backends[] = {
+    {"mem", memMap, unmapBlock},
+    {"sim", simMap, unmapBlock},
+};
+
+static const struct gpioBackend *current = NULL;
+static uint32_t *currentRegs = NULL;
+
+uint32_t *gpioOpen(const char *spec)
+{
+  const char *colon = strchr(spec, ':');
+  size_t n = (colon != NULL) ? (size_t)(colon - spec) : strlen(spec);
+
+  for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+  {
+    if (n >= MAX_NAME || strncmp(spec, backends[i].name, n) != 0 || backends[i].name[n] != '\0')
+      continue;
+    if ((currentRegs = backends[i].map(colon != NULL ? colon + 1 : NULL)) != NULL)
+      current = &backends[i];
+    return currentRegs;
+  }
+
+  errno = ENOENT;
+  return NULL;
+}
+
+void gpioClose(void)
+{
+  if (current == NULL)
+    return;
+  current->unmap(currentRegs);
+  current = NULL;
+  currentRegs = NULL;
+}
+
+const char *gpioBackendName(void)
+{
+  return (current != NULL) ? current->name : NULL;
+}
@@ -0,0 +1,49 @@
+/* ***************************************************************************** */
+/* GPIO backends: where the register block poked by pinMode/writeLED/readButton  */
+/* comes from, see option -g.                                                    */
+/*                                                                               */
+/*   mem[:<base>]   the BCM2837 registers, mmap'ed from /dev/mem (the default)   */
+/*   sim[:<path>]   a simulated register block with the same layout, in memory   */
+/*                  shared through the file <path> (e.g. /dev/shm/mm-gpio), or   */
+/*                  private to the process if no path is given                   */
+/*                                                                               */
+/* In the simulator, a script or test drives the button by setting its bit in    */
+/* GPLEV0, and sees the LEDs in GPSET0/GPCLR0, which hold the mask of the last   */
+/* write; clear them after reading to notice the next write of the same pin.     */
+/* ***************************************************************************** */
+
+#ifndef MM_GPIO_H
+#define MM_GPIO_H
+
+#include <stdint.h>
+
+// physical address of the GPIO registers on the RPi2/3 (BCM2836/7)
+#define GPIO_BASE 0x3F200000
+// size of the register block that is mapped
+#define GPIO_BLOCK_SIZE (4 * 1024)
+
+// word offsets of the registers in the block
+#define GPFSEL0 0
+#define GPSET0 7
+#define GPCLR0 10
+#define GPLEV0 13
+
+/* a way of providing the GPIO registers */
+struct gpioBackend
+{
+  const char *name;
+  uint32_t *(*map)(const char *arg); // register block, or NULL with errno set; @arg@ may be NULL
+  void (*unmap)(uint32_t *regs);
+};
+
+/* map the registers of the backend named in @spec@ ("<name>[:<arg>]"); */
+/* returns NULL with errno set if that fails, or if there is no such backend */
+uint32_t *gpioOpen(const char *spec);
+
+/* unmap the registers returned by gpioOpen() */
+void gpioClose(void);
+
+/* name of the backend in use, or NULL */
+const char *gpioBackendName(void);
+
+#endif
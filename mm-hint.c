@@ -0,0 +1,183 @@
+/* ***************************************************************************** */
+/* Hint engine: consistent secrets and a suggested guess; see mm-hint.h.         */
+/* ***************************************************************************** */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mm-hint.h"
+
+/* ======================================================= */
+/* SECTION: consistent codes                               */
+/* ------------------------------------------------------- */
+
+int hintInit(struct hint *h, int len, int cols)
+{
+  int n = codeSpace(len, cols);
+
+  memset(h, 0, sizeof(*h));
+  if (n < 0 || n > HINT_MAX_CODES)
+    return -1;
+
+  h->len = len;
+  h->cols = cols;
+  h->n = n;
+  h->alive = (uint64_t *)malloc(((size_t)n + 63) / 64 * sizeof(uint64_t));
+  h->idx = (int *)malloc((size_t)n * sizeof(int));
+  h->set = newCodeSet(n, len, cols);
+  if (h->alive == NULL || h->idx == NULL || h->set == NULL ||
+      (h->fb = (unsigned char *)malloc(h->set->stride)) == NULL)
+  {
+    hintFree(h);
+    return -1;
+  }
+
+  hintReset(h);
+  return 0;
+}
+
+void hintFree(struct hint *h)
+{
+  free(h->alive);
+  free(h->idx);
+  freeCodeSet(h->set);
+  free(h->fb);
+  memset(h, 0, sizeof(*h));
+}
+
+void hintReset(struct hint *h)
+{
+  int seq[MAX_SEQL];
+  int words = (h->n + 63) / 64;
+
+  memset(h->alive, 0xff, words * sizeof(uint64_t));
+  if (h->n % 64 != 0)
+    h->alive[words - 1] = (UINT64_C(1) << (h->n % 64)) - 1;
+
+  h->set->n = h->n;
+  for (int k = 0; k < h->n; k++)
+  {
+    h->idx[k] = k;
+    indexToSeq(seq, k, h->len, h->cols);
+    setCode(h->set, k, seq);
+  }
+  h->count = h->n;
+}
+
+int hintUseIndex(struct hint *h, const struct codeIndex *ix)
+{
+  if (ix->len != h->len || ix->cols != h->cols)
+    return -1;
+  h->index = ix;
+  return 0;
+}
+
+int hintConsistent(const struct hint *h, const int *seq)
+{
+  int i = seqToIndex(seq, h->len, h->cols);
+
+  return i >= 0 && (h->alive[i / 64] >> (i % 64) & 1);
+}
+
+/* keep the codes k with fb[k] set, and drop the others */
+static int keepMarked(struct hint *h)
+{
+  int keep = 0;
+
+  // the indices first, clearing the bits of the codes that go ...
+  for (int k = 0; k < h->count; k++)
+  {
+    if (h->fb[k])
+      h->idx[keep++] = h->idx[k];
+    else
+      h->alive[h->idx[k] / 64] &= ~(UINT64_C(1) << (h->idx[k] % 64));
+  }
+
+  // ... then the codes, one peg at a time
+  for (int p = 0; p < h->len; p++)
+  {
+    unsigned char *row = h->set->pegs + (size_t)p * h->set->stride;
+    int j = 0;
+
+    for (int k = 0; k < h->count; k++)
+      if (h->fb[k])
+        row[j++] = row[k];
+  }
+
+  h->set->n = h->count = keep;
+  return keep;
+}
+
+int hintUpdate(struct hint *h, const int *guess, int exact, int approx)
+{
+  int want = exact * (h->len + 1) + approx;
+  int g = (h->index != NULL) ? seqToIndex(guess, h->len, h->cols) : -1;
+
+  if (g < 0)
+  { // score the guess against every code left
+    countMatchesBatch(guess, h->set, h->fb);
+    for (int k = 0; k < h->count; k++)
+      h->fb[k] = (h->fb[k] == want);
+  }
+  else if (h->index->layout == INDEX_DENSE)
+  { // one AND over the bitset, then the codes left follow their bits
+    indexAnd(h->index, h->alive, g, want);
+    for (int k = 0; k < h->count; k++)
+      h->fb[k] = h->alive[h->idx[k] / 64] >> (h->idx[k] % 64) & 1;
+  }
+  else
+  { // merge the codes left with those of the class, both ascending
+    int m, j = 0;
+    const uint16_t *cls = indexClass(h->index, g, want, &m);
+
+    for (int k = 0; k < h->count; k++)
+    {
+      while (j < m && cls[j] < h->idx[k])
+        j++;
+      h->fb[k] = (j < m && cls[j] == h->idx[k]);
+    }
+  }
+
+  return keepMarked(h);
+}
+
+/* ======================================================= */
+/* SECTION: suggestion                                     */
+/* ------------------------------------------------------- */
+
+/* A consistent guess may be the secret, and splitting the codes left by their */
+/* feedback bounds what is left after it. Scoring every consistent code as a  */
+/* guess is quadratic in their number, so at most HINT_TRIES of them, spread  */
+/* evenly over the set, are tried; near the end of a game that is all of them. */
+int hintSuggest(struct hint *h, int *guess)
+{
+  int groups[(MAX_SEQL + 1) * (MAX_SEQL + 1)];
+  int seq[MAX_SEQL];
+  int tries = (h->count < HINT_TRIES) ? h->count : HINT_TRIES;
+  int best = -1;
+
+  for (int t = 0; t < tries; t++)
+  {
+    int k = (int)((int64_t)t * h->count / tries), worst = 0;
+
+    for (int p = 0; p < h->len; p++)
+      seq[p] = h->set->pegs[(size_t)p * h->set->stride + k];
+
+    memset(groups, 0, sizeof(groups));
+    countMatchesBatch(seq, h->set, h->fb);
+    for (int j = 0; j < h->count; j++)
+      groups[h->fb[j]]++;
+    for (int g = 0; g < (h->len + 1) * (h->len + 1); g++)
+      if (groups[g] > worst)
+        worst = groups[g];
+
+    if (best < 0 || worst < best)
+    {
+      best = worst;
+      memcpy(guess, seq, h->len * sizeof(int));
+    }
+  }
+
+  return best;
+}
@@ -0,0 +1,58 @@
+/* ***************************************************************************** */
+/* Hint engine (option -H): the secrets still consistent with the feedback of    */
+/* every round so far, as a bitset over the code space. The consistent codes are */
+/* also kept packed in a code set, in ascending order, so that pruning them with */
+/* the batch kernel and choosing a suggestion costs time in proportion to the    */
+/* codes that are left, not to the whole code space. With an inverted index      */
+/* (mm-index.h, option -X) no code needs to be scored to prune them.             */
+/* ***************************************************************************** */
+
+#ifndef MM_HINT_H
+#define MM_HINT_H
+
+#include <stdint.h>
+
+#include "mm-index.h"
+#include "mm-score.h"
+
+// largest code space the engine takes on: 8 colours of length 7, or 9 of length 6
+#define HINT_MAX_CODES (1 << 21)
+// most consistent codes tried as a suggestion, each scored against all that are left
+#define HINT_TRIES 64
+
+struct hint
+{
+  int len, cols, n;              // configuration and size of the code space
+  int count;                     // codes still consistent
+  uint64_t *alive;               // bit i set: the code of index i is consistent
+  int *idx;                      // indices of the consistent codes, ascending
+  struct codeSet *set;           // the consistent codes themselves, in the same order
+  unsigned char *fb;             // feedback of one guess against the set, then which codes stay
+  const struct codeIndex *index; // prunes instead of the batch kernel, if not NULL
+};
+
+/* set up @h@ for @len@ pegs of @cols@ colours, with every code consistent; */
+/* returns 0, or -1 if the code space is too large or there is no memory   */
+int hintInit(struct hint *h, int len, int cols);
+void hintFree(struct hint *h);
+
+/* prune through the index @ix@ from now on; returns 0, or -1 if it is one of */
+/* another configuration                                                      */
+int hintUseIndex(struct hint *h, const struct codeIndex *ix);
+
+/* make every code consistent again, for a new game */
+void hintReset(struct hint *h);
+
+/* non-zero if the secret may still be @seq@ */
+int hintConsistent(const struct hint *h, const int *seq);
+
+/* drop the codes that wouldn't have given @exact@ and @approx@ for @guess@; */
+/* returns the number of codes left                                         */
+int hintUpdate(struct hint *h, const int *guess, int exact, int approx);
+
+/* put a consistent code into @guess@ that splits the codes left into small */
+/* groups by their feedback; returns the size of the largest such group, or */
+/* -1 if no code is consistent any more                                     */
+int hintSuggest(struct hint *h, int *guess);
+
+#endif
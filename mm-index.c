@@ -0,0 +1,298 @@
+/* ***************************************************************************** */
+/* Inverted index of (guess, feedback) to secrets; see mm-index.h.               */
+/*                                                                               */
+/* A file holds a header, then the data: the bitsets of the dense layout, or the */
+/* offsets and then the code indices of the sparse one. It is written in the     */
+/* byte order of the machine, which the header records.                          */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-index.h"
+#include "mm-score.h"
+
+#define INDEX_MAGIC "MMINDEX"
+#define INDEX_VERSION 1
+#define INDEX_ORDER 0x01020304
+// the data starts here, 64-bit aligned
+#define INDEX_DATA 64
+
+struct indexHeader
+{
+  char magic[8];
+  uint32_t version, order;
+  int32_t len, cols, n, classes, words, layout;
+  uint64_t size; // of the whole file
+};
+
+/* ======================================================= */
+/* SECTION: layout                                         */
+/* ------------------------------------------------------- */
+
+/* bytes of the index for @n@ codes in @layout@, header included */
+static size_t indexSize(int n, int classes, int words, enum indexLayout layout)
+{
+  if (layout == INDEX_DENSE)
+    return INDEX_DATA + (size_t)n * classes * words * sizeof(uint64_t);
+  return INDEX_DATA + (size_t)n * (classes + 1) * sizeof(uint32_t) + (size_t)n * n * sizeof(uint16_t);
+}
+
+/* point the fields of @ix@ into its memory, from the header there */
+static void setPointers(struct codeIndex *ix)
+{
+  const struct indexHeader *hd = ix->mem;
+  const char *data = (const char *)ix->mem + INDEX_DATA;
+
+  ix->len = hd->len;
+  ix->cols = hd->cols;
+  ix->n = hd->n;
+  ix->classes = hd->classes;
+  ix->words = hd->words;
+  ix->layout = (enum indexLayout)hd->layout;
+  ix->bits = NULL;
+  ix->offsets = NULL;
+  ix->codes = NULL;
+  if (ix->layout == INDEX_DENSE)
+    ix->bits = (const uint64_t *)data;
+  else
+  {
+    ix->offsets = (const uint32_t *)data;
+    ix->codes = (const uint16_t *)(data + (size_t)ix->n * (ix->classes + 1) * sizeof(uint32_t));
+  }
+}
+
+/* non-zero if the offsets of the sparse index @ix@ split the n codes of each guess */
+/* into its classes, in order, so that no lookup can read outside codes[]          */
+static int sparseValid(const struct codeIndex *ix)
+{
+  uint32_t n = (uint32_t)ix->n;
+
+  for (uint32_t g = 0; g < n; g++)
+  {
+    const uint32_t *off = ix->offsets + (size_t)g * (ix->classes + 1);
+
+    if (off[0] != g * n || off[ix->classes] != (g + 1) * n)
+      return 0;
+    for (int f = 0; f < ix->classes; f++)
+      if (off[f + 1] < off[f])
+        return 0;
+  }
+
+  return 1;
+}
+
+/* ======================================================= */
+/* SECTION: building                                       */
+/* ------------------------------------------------------- */
+
+int indexBuildLayout(struct codeIndex *ix, int len, int cols, enum indexLayout layout)
+{
+  int n = codeSpace(len, cols), classes = (len + 1) * (len + 1), seq[MAX_SEQL];
+  uint32_t pos[(MAX_SEQL + 1) * (MAX_SEQL + 1) + 1];
+  struct indexHeader *hd;
+  struct codeSet *set;
+  unsigned char *fb;
+  size_t size;
+  int words;
+
+  memset(ix, 0, sizeof(*ix));
+  if (n < 0)
+    return -1;
+  words = (n + 63) / 64;
+  size = indexSize(n, classes, words, layout);
+  if ((layout == INDEX_DENSE && size > INDEX_DENSE_MAX) ||
+      (layout == INDEX_SPARSE && (n > UINT16_MAX + 1 || size > INDEX_SPARSE_MAX)))
+    return -1;
+
+  if ((set = codeSpaceSet(len, cols)) == NULL)
+    return -1;
+  if ((fb = (unsigned char *)malloc(set->stride)) == NULL || (ix->mem = calloc(1, size)) == NULL)
+  {
+    free(fb);
+    freeCodeSet(set);
+    return -1;
+  }
+
+  hd = ix->mem;
+  memcpy(hd->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  hd->version = INDEX_VERSION;
+  hd->order = INDEX_ORDER;
+  hd->len = len;
+  hd->cols = cols;
+  hd->n = n;
+  hd->classes = classes;
+  hd->words = words;
+  hd->layout = layout;
+  hd->size = size;
+  ix->size = size;
+  setPointers(ix);
+
+  // the feedback is symmetric, so scoring guess g against every code gives the secrets of each (g, f)
+  for (int g = 0; g < n; g++)
+  {
+    indexToSeq(seq, g, len, cols);
+    countMatchesBatch(seq, set, fb);
+
+    if (layout == INDEX_DENSE)
+    {
+      uint64_t *bits = (uint64_t *)ix->bits + (size_t)g * classes * words;
+
+      for (int k = 0; k < n; k++)
+        bits[(size_t)fb[k] * words + k / 64] |= UINT64_C(1) << (k % 64);
+    }
+    else
+    {
+      uint32_t *off = (uint32_t *)ix->offsets + (size_t)g * (classes + 1);
+      uint16_t *codes = (uint16_t *)ix->codes;
+
+      // count the codes of each class, then place them in ascending order
+      memset(pos, 0, sizeof(pos));
+      for (int k = 0; k < n; k++)
+        pos[fb[k] + 1]++;
+      pos[0] = (uint32_t)g * n;
+      for (int f = 1; f <= classes; f++)
+        pos[f] += pos[f - 1];
+      memcpy(off, pos, (classes + 1) * sizeof(uint32_t));
+      for (int k = 0; k < n; k++)
+        codes[pos[fb[k]]++] = (uint16_t)k;
+    }
+  }
+
+  free(fb);
+  freeCodeSet(set);
+  return 0;
+}
+
+int indexBuild(struct codeIndex *ix, int len, int cols)
+{
+  if (indexBuildLayout(ix, len, cols, INDEX_DENSE) == 0)
+    return 0;
+  return indexBuildLayout(ix, len, cols, INDEX_SPARSE);
+}
+
+/* ======================================================= */
+/* SECTION: files                                          */
+/* ------------------------------------------------------- */
+
+/* written to a temporary file that replaces @path@ once complete, */
+/* so that a file of that name is always a whole index              */
+int indexSave(const struct codeIndex *ix, const char *path)
+{
+  char tmp[PATH_MAX];
+  FILE *f;
+
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  if ((f = fopen(tmp, "wb")) == NULL)
+    return -1;
+  if (fwrite(ix->mem, 1, ix->size, f) != ix->size)
+  {
+    int err = errno;
+    fclose(f);
+    unlink(tmp);
+    errno = err;
+    return -1;
+  }
+  if (fclose(f) != 0 || rename(tmp, path) != 0)
+  {
+    int err = errno;
+    unlink(tmp);
+    errno = err;
+    return -1;
+  }
+
+  return 0;
+}
+
+int indexLoad(struct codeIndex *ix, const char *path, int len, int cols)
+{
+  const struct indexHeader *hd;
+  struct stat st;
+  void *mem;
+  int fd, err = 0;
+
+  memset(ix, 0, sizeof(*ix));
+  if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    return -1;
+  if (fstat(fd, &st) != 0)
+    err = errno;
+  else if (st.st_size < INDEX_DATA)
+    err = EINVAL;
+  else if ((mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    err = errno;
+  close(fd);
+  if (err != 0)
+  {
+    errno = err;
+    return -1;
+  }
+
+  hd = mem;
+  if (memcmp(hd->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+    err = EINVAL;
+  else if (hd->version != INDEX_VERSION || hd->order != INDEX_ORDER || hd->len != len || hd->cols != cols)
+    err = ESTALE;
+  else if (hd->n != codeSpace(len, cols) || hd->classes != (len + 1) * (len + 1) || hd->words != (hd->n + 63) / 64 ||
+           (hd->layout != INDEX_DENSE && hd->layout != INDEX_SPARSE) || hd->size != (uint64_t)st.st_size ||
+           hd->size != indexSize(hd->n, hd->classes, hd->words, (enum indexLayout)hd->layout))
+    err = EINVAL; // truncated or damaged
+  if (err != 0)
+  {
+    munmap(mem, st.st_size);
+    errno = err;
+    return -1;
+  }
+
+  ix->mem = mem;
+  ix->size = st.st_size;
+  ix->mapped = 1;
+  setPointers(ix);
+  if (ix->layout == INDEX_SPARSE && !sparseValid(ix))
+  {
+    indexFree(ix);
+    errno = EINVAL;
+    return -1;
+  }
+  return 0;
+}
+
+void indexFree(struct codeIndex *ix)
+{
+  if (ix->mapped)
+    munmap(ix->mem, ix->size);
+  else
+    free(ix->mem);
+  memset(ix, 0, sizeof(*ix));
+}
+
+/* ======================================================= */
+/* SECTION: lookup                                         */
+/* ------------------------------------------------------- */
+
+void indexAnd(const struct codeIndex *ix, uint64_t *alive, int g, int fb)
+{
+  const uint64_t *bits = ix->bits + ((size_t)g * ix->classes + fb) * ix->words;
+
+  for (int w = 0; w < ix->words; w++)
+    alive[w] &= bits[w];
+}
+
+const uint16_t *indexClass(const struct codeIndex *ix, int g, int fb, int *count)
+{
+  const uint32_t *off = ix->offsets + (size_t)g * (ix->classes + 1) + fb;
+
+  *count = off[1] - off[0];
+  return ix->codes + off[0];
+}
@@ -0,0 +1,73 @@
+/* ***************************************************************************** */
+/* Inverted index of the code space: for every guess and every feedback, the set */
+/* of secrets that give that feedback for that guess. The codes consistent with  */
+/* a round are then one lookup, instead of scoring the guess against each code.  */
+/* The layout is chosen by the size of the code space:                           */
+/*                                                                               */
+/*   dense    a bitset over the code space per (guess, feedback); pruning is an  */
+/*            AND of 64-bit words                                                */
+/*   sparse   per guess, the code indices grouped by feedback, ascending, as     */
+/*            16-bit numbers; pruning is a merge with the codes that are left    */
+/*                                                                               */
+/* An index is built in memory, and can be saved to a file that is mapped in     */
+/* read-only on the next start, so it costs no time to load.                     */
+/* ***************************************************************************** */
+
+#ifndef MM_INDEX_H
+#define MM_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// most bytes of a dense index; 8 colours of length 4 still fit
+#define INDEX_DENSE_MAX ((size_t)64 << 20)
+// most bytes of a sparse index; 6 colours of length 5 still fit
+#define INDEX_SPARSE_MAX ((size_t)256 << 20)
+
+enum indexLayout
+{
+  INDEX_DENSE,
+  INDEX_SPARSE
+};
+
+struct codeIndex
+{
+  int len, cols, n;
+  int classes; // feedback classes per guess, packed as in PACK_MATCHES
+  int words;   // 64-bit words of a bitset over the code space
+  enum indexLayout layout;
+  const uint64_t *bits;    // dense: the set of (g, f) at bits + (g * classes + f) * words
+  const uint32_t *offsets; // sparse: class f of guess g is codes[offsets[g * (classes + 1) + f] ..
+  const uint16_t *codes;   //         offsets[g * (classes + 1) + f + 1] - 1]
+  void *mem;               // the header and data, malloc'ed or mapped
+  size_t size;
+  int mapped;
+};
+
+/* build the index for @len@ pegs of @cols@ colours in memory, dense if that fits */
+/* into INDEX_DENSE_MAX; returns 0, or -1 if it is too large for either layout    */
+/* or there is no memory                                                          */
+int indexBuild(struct codeIndex *ix, int len, int cols);
+
+/* the same, in the given @layout@ */
+int indexBuildLayout(struct codeIndex *ix, int len, int cols, enum indexLayout layout);
+
+/* write @ix@ to the file @path@; returns 0, or -1 with errno set */
+int indexSave(const struct codeIndex *ix, const char *path);
+
+/* map the index in the file @path@ read-only; returns 0, or -1 with errno set; */
+/* errno is ESTALE for an index of another configuration or version, and      */
+/* EINVAL for a file that is no index at all, or a truncated or damaged one   */
+int indexLoad(struct codeIndex *ix, const char *path, int len, int cols);
+
+void indexFree(struct codeIndex *ix);
+
+/* intersect the bitset @alive@ with the codes that give feedback @fb@ to the */
+/* guess of index @g@; dense layout only                                     */
+void indexAnd(const struct codeIndex *ix, uint64_t *alive, int g, int fb);
+
+/* the codes, ascending, that give feedback @fb@ to the guess of index @g@, */
+/* and their number in @count@; sparse layout only                         */
+const uint16_t *indexClass(const struct codeIndex *ix, int g, int fb, int *count);
+
+#endif
@@ -0,0 +1,169 @@
+/* ***************************************************************************** */
+/* Button sampling thread and its event ring; see mm-input.h.                    */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "mm-button.h"
+#include "mm-clock.h"
+#include "mm-input.h"
+#include "mm-rt.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+int failure(int fatal, const char *message, ...);
+uint32_t readPins(uint32_t *gpio);
+
+static struct ring events;
+static unsigned long overruns = 0;
+
+static uint32_t *sampleGPIO;
+static uint32_t sampleMask;
+static long periodNs;
+static loop_fn consumer;
+static int efd = -1;
+
+/* debouncer state, one bit or slot per pin; only the sampler touches it */
+static uint32_t level = 0, haveEdge = 0;
+static uint64_t lastEdge[32];
+
+/* ======================================================= */
+/* SECTION: sampling                                       */
+/* ------------------------------------------------------- */
+
+/* read the buttons once; a change of a button's level is an event, unless it   */
+/* comes within DEBOUNCE_US of its last one, which makes it contact bounce;     */
+/* returns 1 if an event was pushed                                              */
+static int sampleOnce(void)
+{
+  uint32_t now = readPins(sampleGPIO) & sampleMask, changed = now ^ level;
+  struct inputEvent ev;
+  int pushed = 0;
+
+  if (changed == 0)
+    return 0;
+
+  ev.t = clockNow();
+  for (; changed != 0; changed &= changed - 1)
+  {
+    int pin = __builtin_ctz(changed);
+    uint32_t bit = 1u << pin;
+
+    if ((haveEdge & bit) && ev.t - lastEdge[pin] < DEBOUNCE_US)
+      continue;
+    level ^= bit;
+    lastEdge[pin] = ev.t;
+    haveEdge |= bit;
+    ev.pressed = (now & bit) != 0;
+    ev.pin = pin;
+    if (ringPush(&events, &ev))
+      pushed = 1;
+    else
+      overruns++;
+  }
+
+  return pushed;
+}
+
+/* real clock: sample on an absolute CLOCK_MONOTONIC schedule, so the rate doesn't drift */
+static void *sampler(void *arg)
+{
+  struct timespec next, woke;
+  sigset_t all;
+  uint64_t one = 1;
+
+  (void)arg;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+  rtBoostThread(2); // above the game loop and the PWM thread; it must never wait for either
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (;;)
+  {
+    if (sampleOnce() && write(efd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+      failure(TRUE, "input: write to eventfd failed: %s\n", strerror(errno));
+
+    next.tv_nsec += periodNs;
+    while (next.tv_nsec >= 1000000000)
+    {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &woke);
+    rtRecordWake(WAKE_SAMPLER, (int64_t)(woke.tv_sec - next.tv_sec) * 1000000000 + (woke.tv_nsec - next.tv_nsec));
+  }
+
+  return NULL;
+}
+
+/* ======================================================= */
+/* SECTION: event loop handlers                            */
+/* ------------------------------------------------------- */
+
+/* real clock: the eventfd is readable */
+static void onEventFd(void *arg)
+{
+  uint64_t n;
+
+  if (read(efd, &n, sizeof(n)) < 0 && errno != EAGAIN)
+    failure(TRUE, "input: read of eventfd failed: %s\n", strerror(errno));
+  consumer(arg);
+}
+
+/* virtual clock: a periodic timer samples in place of the thread */
+static void onSampleTimer(void *arg)
+{
+  if (sampleOnce())
+    consumer(arg);
+}
+
+/* ======================================================= */
+/* SECTION: interface                                      */
+/* ------------------------------------------------------- */
+
+int inputStart(uint32_t *gpio, uint32_t buttons, int rateHz, loop_fn onEvents)
+{
+  pthread_t thread;
+
+  sampleGPIO = gpio;
+  sampleMask = buttons;
+  periodNs = 1000000000L / rateHz;
+  consumer = onEvents;
+  level = readPins(gpio) & buttons;
+
+  if (strcmp(clockName(), "virtual") == 0)
+    return (loopAddTimer(0, periodNs / 1000, onSampleTimer, NULL) < 0) ? -1 : 0;
+
+  if ((efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+    return -1;
+  if (loopAddFd(efd, onEventFd, NULL) != 0)
+    return -1;
+  if ((errno = pthread_create(&thread, NULL, sampler, NULL)) != 0)
+    return -1;
+  pthread_detach(thread);
+
+  return 0;
+}
+
+int inputPop(struct inputEvent *ev)
+{
+  return ringPop(&events, ev);
+}
+
+unsigned long inputOverruns(void)
+{
+  return overruns;
+}
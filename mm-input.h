@@ -0,0 +1,33 @@
+/* ***************************************************************************** */
+/* Button sampling: a thread reads GPLEV0 at a fixed rate, debounces the bits of */
+/* the buttons, and pushes time-stamped press/release events into an SPSC ring   */
+/* (mm-ring.h); an eventfd wakes the event loop, whose handler takes them out.   */
+/* One read of the register samples all buttons, e.g. those of several stations. */
+/* The sampler never waits for the game. On the virtual clock, a periodic timer  */
+/* of the event loop samples instead of the thread.                              */
+/* Used when the GPIO chip gives no edge events (see mm-button.h).               */
+/* ***************************************************************************** */
+
+#ifndef MM_INPUT_H
+#define MM_INPUT_H
+
+#include <stdint.h>
+
+#include "mm-loop.h"
+#include "mm-ring.h"
+
+// default sampling rate, in Hz
+#define SAMPLE_RATE 1000
+
+/* start sampling the buttons in the mask @buttons@ (BCM pins 0..31) at @rateHz@, */
+/* and call @onEvents@ from the event loop when events are pending; returns 0,    */
+/* or -1 with errno set                                                           */
+int inputStart(uint32_t *gpio, uint32_t buttons, int rateHz, loop_fn onEvents);
+
+/* consumer: take the oldest pending event into @ev@; returns 0 if there is none */
+int inputPop(struct inputEvent *ev);
+
+/* number of events dropped because the ring was full */
+unsigned long inputOverruns(void);
+
+#endif
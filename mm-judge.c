@@ -0,0 +1,262 @@
+/* ***************************************************************************** */
+/* Bulk judge: score many (secret, guess) pairs in one process, see option -b.   */
+/*                                                                               */
+/* Text format: one pair per line, two digit strings separated by blanks,        */
+/*   e.g. "123 321"; the output is one line "<exact> <approx>" per pair.         */
+/* Binary format (-B): each pair is 2*len bytes, the colours of the secret then  */
+/*   of the guess, one byte per peg; the output is one byte per pair, holding    */
+/*   the packed feedback exact*(len+1)+approx.                                   */
+/*                                                                               */
+/* Regular files are memory-mapped; anything else (e.g. stdin, given as "-") is  */
+/* read in large chunks. Pairs are parsed and scored in batches of JUDGE_BATCH,  */
+/* and the results collected in one output buffer that is written when full.    */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm-score.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+// number of pairs parsed before they are scored
+#define JUDGE_BATCH 4096
+// size of the output buffer, and of the chunks read from a pipe
+#define JUDGE_BUF (1 << 20)
+
+int failure(int fatal, const char *message, ...);
+
+struct judge
+{
+  int len, cols, binary;
+  score_fn kernel;
+  long line; // current input line (text) or pair (binary), for error messages
+  int pairs;  // pairs parsed into seqs[] but not yet scored
+  long total; // pairs scored so far
+  int seqs[JUDGE_BATCH * 2 * MAX_SEQL];
+  size_t outLen;
+  char out[JUDGE_BUF];
+};
+
+/* ======================================================= */
+/* SECTION: output                                         */
+/* ------------------------------------------------------- */
+
+static void flushOutput(struct judge *j)
+{
+  size_t done = 0;
+
+  while (done < j->outLen)
+  {
+    ssize_t n = write(STDOUT_FILENO, j->out + done, j->outLen - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      failure(TRUE, "bulk: write failed: %s\n", strerror(errno));
+    done += n;
+  }
+  j->outLen = 0;
+}
+
+/* score the parsed pairs and append the results to the output buffer */
+static void scoreBatch(struct judge *j)
+{
+  size_t need = (size_t)j->pairs * (j->binary ? 1 : 4);
+  int *seq = j->seqs;
+
+  if (j->outLen + need > JUDGE_BUF)
+    flushOutput(j);
+
+  for (int i = 0; i < j->pairs; i++, seq += 2 * j->len)
+  {
+    struct matches res = j->kernel(seq, seq + j->len);
+    if (j->binary)
+    {
+      j->out[j->outLen++] = (char)PACK_MATCHES(res, j->len);
+    }
+    else
+    { // both counts are at most MAX_SEQL, i.e. a single digit
+      j->out[j->outLen++] = (char)('0' + res.exact);
+      j->out[j->outLen++] = ' ';
+      j->out[j->outLen++] = (char)('0' + res.approx);
+      j->out[j->outLen++] = '\n';
+    }
+  }
+
+  j->total += j->pairs;
+  j->pairs = 0;
+}
+
+/* ======================================================= */
+/* SECTION: parsing                                        */
+/* ------------------------------------------------------- */
+
+/* read exactly j->len digits 1..cols from @p@ into @seq@; returns the position */
+/* after them, or NULL if the input is malformed                               */
+static const char *parseSeq(struct judge *j, const char *p, const char *end, int *seq)
+{
+  for (int i = 0; i < j->len; i++, p++)
+  {
+    if (p == end || *p < '1' || *p > '0' + j->cols)
+      return NULL;
+    seq[i] = *p - '0';
+  }
+  if (p != end && *p >= '0' && *p <= '9')
+    return NULL;
+
+  return p;
+}
+
+/* parse and score all complete lines in @buf@; if @eof@, a last line without */
+/* newline is complete too; returns the number of bytes consumed              */
+static size_t judgeText(struct judge *j, const char *buf, size_t n, int eof)
+{
+  const char *p = buf, *end = buf + n;
+
+  for (;;)
+  {
+    const char *nl = memchr(p, '\n', end - p);
+    const char *eol = (nl != NULL) ? nl : end;
+    const char *q = p;
+
+    if (nl == NULL && (!eof || p == end))
+      break;
+
+    j->line++;
+    while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r'))
+      q++;
+    if (q < eol)
+    { // skip blank lines; anything else must be a pair
+      int *seq = j->seqs + j->pairs * 2 * j->len;
+      if ((q = parseSeq(j, q, eol, seq)) == NULL)
+        failure(TRUE, "bulk: malformed first sequence in line %ld\n", j->line);
+      while (q < eol && (*q == ' ' || *q == '\t'))
+        q++;
+      if ((q = parseSeq(j, q, eol, seq + j->len)) == NULL)
+        failure(TRUE, "bulk: malformed second sequence in line %ld\n", j->line);
+      while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r'))
+        q++;
+      if (q != eol)
+        failure(TRUE, "bulk: trailing characters in line %ld\n", j->line);
+      if (++j->pairs == JUDGE_BATCH)
+        scoreBatch(j);
+    }
+
+    p = (nl != NULL) ? nl + 1 : end;
+  }
+
+  return p - buf;
+}
+
+/* parse and score all complete records in @buf@; returns the bytes consumed */
+static size_t judgeBinary(struct judge *j, const char *buf, size_t n, int eof)
+{
+  size_t rec = 2 * j->len, done = 0;
+
+  for (; done + rec <= n; done += rec)
+  {
+    int *seq = j->seqs + j->pairs * rec;
+    j->line++;
+    for (size_t i = 0; i < rec; i++)
+    {
+      unsigned char c = (unsigned char)buf[done + i];
+      if (c < 1 || c > j->cols)
+        failure(TRUE, "bulk: colour %d out of range in pair %ld\n", c, j->line);
+      seq[i] = c;
+    }
+    if (++j->pairs == JUDGE_BATCH)
+      scoreBatch(j);
+  }
+
+  if (eof && done != n)
+    failure(TRUE, "bulk: truncated record after pair %ld\n", j->line);
+
+  return done;
+}
+
+/* ======================================================= */
+/* SECTION: input                                          */
+/* ------------------------------------------------------- */
+
+static size_t judgeChunk(struct judge *j, const char *buf, size_t n, int eof)
+{
+  return j->binary ? judgeBinary(j, buf, n, eof) : judgeText(j, buf, n, eof);
+}
+
+/* read pairs from @path@ ("-" for stdin), score them with @kernel@ and write   */
+/* the results to stdout; @binary@ selects the binary format; returns the number */
+/* of pairs scored                                                               */
+long bulkJudge(const char *path, int binary, int len, int cols, score_fn kernel)
+{
+  struct judge *j = (struct judge *)malloc(sizeof(struct judge));
+  struct stat st;
+  int fd;
+
+  if (j == NULL)
+    failure(TRUE, "bulk: out of memory\n");
+  j->len = len;
+  j->cols = cols;
+  j->binary = binary;
+  j->kernel = kernel;
+  j->line = 0;
+  j->pairs = 0;
+  j->total = 0;
+  j->outLen = 0;
+
+  if (strcmp(path, "-") == 0)
+    fd = STDIN_FILENO;
+  else if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    failure(TRUE, "bulk: unable to open %s: %s\n", path, strerror(errno));
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+  { // regular file: map it and parse it in one go
+    char *map = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+      failure(TRUE, "bulk: mmap of %s failed: %s\n", path, strerror(errno));
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    judgeChunk(j, map, st.st_size, 1);
+    munmap(map, st.st_size);
+  }
+  else
+  { // pipe or terminal: read large chunks, and keep an incomplete last line
+    char *buf = (char *)malloc(JUDGE_BUF);
+    size_t have = 0;
+
+    for (;;)
+    {
+      ssize_t n = read(fd, buf + have, JUDGE_BUF - have);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        failure(TRUE, "bulk: read failed: %s\n", strerror(errno));
+      have += n;
+      size_t used = judgeChunk(j, buf, have, n == 0);
+      memmove(buf, buf + used, have - used);
+      have -= used;
+      if (n == 0)
+        break;
+      if (have == JUDGE_BUF)
+        failure(TRUE, "bulk: line %ld too long\n", j->line + 1);
+    }
+    free(buf);
+  }
+
+  if (fd != STDIN_FILENO)
+    close(fd);
+
+  scoreBatch(j);
+  flushOutput(j);
+
+  long pairs = j->total;
+  free(j);
+  return pairs;
+}
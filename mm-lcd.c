@@ -0,0 +1,231 @@
+/* ***************************************************************************** */
+/* HD44780 LCD driver with a framebuffer and diff-based refresh; see mm-lcd.h.   */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "mm-lcd.h"
+
+#define INPUT 0
+#define OUTPUT 1
+
+// HD44780 commands
+#define LCD_CLEAR 0x01
+#define LCD_HOME 0x02
+#define LCD_ENTRY 0x06    // entry mode: increment the address, don't shift
+#define LCD_DISPLAY 0x0C  // display on, cursor and blink off
+#define LCD_FUNCTION 0x28 // 4-bit interface, 2 lines, 5x8 font
+#define LCD_DDRAM 0x80    // set the display RAM address
+// display RAM address of the start of the second row
+#define ROW2_ADDR 0x40
+
+void pinMode(uint32_t *gpio, int pin, int mode);
+void writePins(uint32_t *gpio, uint32_t setMask, uint32_t clearMask);
+void delayMicroseconds(unsigned int howLong);
+
+/* ======================================================= */
+/* SECTION: controller on the GPIO pins                    */
+/* ------------------------------------------------------- */
+
+static uint32_t *lcdGPIO;
+static const int dataPins[4] = {LCD_D4, LCD_D5, LCD_D6, LCD_D7};
+
+/* put @nibble@ on D4..D7 and @rs@ on RS, with one store to GPSET0 and one to */
+/* GPCLR0, and strobe them in on the falling edge of E                        */
+static void sendNibble(int rs, uint8_t nibble)
+{
+  uint32_t set = 0, clear = 0;
+
+  for (int b = 0; b < 4; b++)
+  {
+    if (nibble & (1 << b))
+      set |= 1u << dataPins[b];
+    else
+      clear |= 1u << dataPins[b];
+  }
+  if (rs)
+    set |= 1u << LCD_RS;
+  else
+    clear |= 1u << LCD_RS;
+
+  writePins(lcdGPIO, set, clear);
+  writePins(lcdGPIO, 1u << LCD_E, 0);
+  delayMicroseconds(1); // enable pulse width, at least 450ns
+  writePins(lcdGPIO, 0, 1u << LCD_E);
+  delayMicroseconds(1);
+}
+
+static void gpioCommand(uint8_t cmd)
+{
+  sendNibble(0, cmd >> 4);
+  sendNibble(0, cmd & 0xF);
+  // clear and home take 1.52ms, everything else 37us
+  delayMicroseconds((cmd == LCD_CLEAR || (cmd & 0xFE) == LCD_HOME) ? 1600 : 40);
+}
+
+static void gpioData(uint8_t ch)
+{
+  sendNibble(1, ch >> 4);
+  sendNibble(1, ch & 0xF);
+  delayMicroseconds(45);
+}
+
+/* initialisation by instruction, as in the HD44780 data sheet (figure 24) */
+static void gpioInit(uint32_t *gpio)
+{
+  uint32_t all = (1u << LCD_RS) | (1u << LCD_E);
+
+  lcdGPIO = gpio;
+  pinMode(gpio, LCD_RS, OUTPUT);
+  pinMode(gpio, LCD_E, OUTPUT);
+  for (int b = 0; b < 4; b++)
+  {
+    pinMode(gpio, dataPins[b], OUTPUT);
+    all |= 1u << dataPins[b];
+  }
+  writePins(gpio, 0, all);
+  delayMicroseconds(50000); // after power-on
+
+  // three times 8-bit mode, whatever state the controller was in, then 4-bit mode
+  sendNibble(0, 0x3);
+  delayMicroseconds(4500);
+  sendNibble(0, 0x3);
+  delayMicroseconds(150);
+  sendNibble(0, 0x3);
+  delayMicroseconds(150);
+  sendNibble(0, 0x2);
+  delayMicroseconds(150);
+
+  gpioCommand(LCD_FUNCTION);
+  gpioCommand(LCD_DISPLAY);
+  gpioCommand(LCD_CLEAR);
+  gpioCommand(LCD_ENTRY);
+}
+
+/* ======================================================= */
+/* SECTION: simulated controller                           */
+/* ------------------------------------------------------- */
+
+static char ddram[128];
+static int ddramAddr = 0;
+
+static void simCommand(uint8_t cmd)
+{
+  if (cmd & LCD_DDRAM)
+    ddramAddr = cmd & 0x7F;
+  else if (cmd == LCD_CLEAR)
+  {
+    memset(ddram, ' ', sizeof(ddram));
+    ddramAddr = 0;
+  }
+  else if ((cmd & 0xFE) == LCD_HOME)
+    ddramAddr = 0;
+}
+
+static void simData(uint8_t ch)
+{
+  ddram[ddramAddr] = (char)ch;
+  ddramAddr = (ddramAddr + 1) & 0x7F;
+}
+
+static void simInit(uint32_t *gpio)
+{
+  (void)gpio;
+  simCommand(LCD_CLEAR);
+}
+
+static void simShow(int commands, int chars)
+{
+  fprintf(stdout, "LCD |%.*s|  %d commands, %d characters\n", LCD_COLS, ddram, commands, chars);
+  fprintf(stdout, "    |%.*s|\n", LCD_COLS, ddram + ROW2_ADDR);
+}
+
+/* ======================================================= */
+/* SECTION: framebuffer                                    */
+/* ------------------------------------------------------- */
+
+static const struct lcdBackend backends[] = {
+    {"gpio", gpioInit, gpioCommand, gpioData, NULL},
+    {"sim", simInit, simCommand, simData, simShow},
+};
+
+static const struct lcdBackend *current = NULL;
+static char frame[LCD_ROWS][LCD_COLS]; // what the game drew
+static char shown[LCD_ROWS][LCD_COLS]; // what the controller displays
+static int cursor = 0;                 // the controller's display RAM address
+
+int lcdOpen(const char *name, uint32_t *gpio)
+{
+  for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+  {
+    if (strcmp(name, backends[i].name) != 0)
+      continue;
+    current = &backends[i];
+    current->init(gpio); // ends with a cleared display, at address 0
+    memset(frame, ' ', sizeof(frame));
+    memset(shown, ' ', sizeof(shown));
+    cursor = 0;
+    return 0;
+  }
+
+  return -1;
+}
+
+void lcdClear(void)
+{
+  memset(frame, ' ', sizeof(frame));
+}
+
+void lcdPrintf(int row, int col, const char *fmt, ...)
+{
+  char buf[LCD_COLS + 1];
+  va_list args;
+
+  if (row < 0 || row >= LCD_ROWS || col < 0 || col >= LCD_COLS)
+    return;
+
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+
+  for (int i = 0; buf[i] != '\0' && col + i < LCD_COLS; i++)
+    frame[row][col + i] = buf[i];
+}
+
+int lcdRefresh(void)
+{
+  int commands = 0, chars = 0;
+
+  if (current == NULL)
+    return 0;
+
+  for (int row = 0; row < LCD_ROWS; row++)
+  {
+    for (int col = 0; col < LCD_COLS; col++)
+    {
+      int addr = row * ROW2_ADDR + col;
+
+      if (frame[row][col] == shown[row][col])
+        continue;
+      // the address increments after each character, so a run of changes needs one move
+      if (addr != cursor)
+      {
+        current->command(LCD_DDRAM | addr);
+        commands++;
+      }
+      current->data((uint8_t)frame[row][col]);
+      chars++;
+      shown[row][col] = frame[row][col];
+      cursor = addr + 1;
+    }
+  }
+
+  if (commands + chars > 0 && current->show != NULL)
+    current->show(commands, chars);
+
+  return commands + chars;
+}
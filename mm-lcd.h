@@ -0,0 +1,54 @@
+/* ***************************************************************************** */
+/* 16x2 HD44780 LCD: the game draws into a framebuffer, and lcdRefresh() sends   */
+/* the controller only the characters that changed since the last refresh, as    */
+/* each byte costs two enable pulses and ~40us of command time in 4-bit mode.    */
+/*                                                                               */
+/*   gpio   the controller wired to the mmap'ed GPIO pins below, in 4-bit mode;  */
+/*          only with option -L, as the pins may be wired to something else      */
+/*   sim    a model of the controller's display RAM, fed the same commands and   */
+/*          printed to stdout after each refresh (for headless runs)             */
+/* ***************************************************************************** */
+
+#ifndef MM_LCD_H
+#define MM_LCD_H
+
+#include <stdint.h>
+
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+// BCM pins of the LCD: register select, enable (strobe) and data lines D4..D7
+#define LCD_RS 25
+#define LCD_E 24
+#define LCD_D4 23
+#define LCD_D5 10
+#define LCD_D6 27
+#define LCD_D7 22
+
+/* a controller: initialise it on the pins of the mmaped @gpio@ block, and */
+/* send it a command or a data byte                                         */
+struct lcdBackend
+{
+  const char *name;
+  void (*init)(uint32_t *gpio);
+  void (*command)(uint8_t cmd);
+  void (*data)(uint8_t ch);
+  void (*show)(int commands, int chars); // after a refresh that sent something; may be NULL
+};
+
+/* initialise the controller of backend @name@ and blank the display; */
+/* returns 0, or -1 if there is no such backend                       */
+int lcdOpen(const char *name, uint32_t *gpio);
+
+/* blank the framebuffer */
+void lcdClear(void);
+
+/* print into the framebuffer at @row@, @col@; what goes past the end */
+/* of the row is cut off                                               */
+void lcdPrintf(int row, int col, const char *fmt, ...);
+
+/* send the characters that changed since the last refresh to the display; */
+/* returns how many bytes (commands and characters) were sent               */
+int lcdRefresh(void);
+
+#endif
@@ -0,0 +1,159 @@
+/* ***************************************************************************** */
+/* LED sequencer on the timers of the event loop; see mm-led.h.                  */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "mm-led.h"
+#include "mm-loop.h"
+#include "mm-pwm.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+#define LOW 0
+#define HIGH 1
+
+int failure(int fatal, const char *message, ...);
+void writeLED(uint32_t *gpio, int led, int value);
+
+static void ledTick(void *arg);
+
+/* wake the sequencer @q@ in @ms@ milli-seconds; without a timer it would never */
+/* finish its step, and ledWait() would wait for ever                           */
+static void armTick(struct ledSeq *q, int ms)
+{
+  if ((q->timer = loopAddTimer((uint64_t)ms * 1000, 0, ledTick, q)) < 0)
+    failure(TRUE, "led: out of timers\n");
+}
+
+/* start playing the head step, dropping steps that do nothing */
+static void startStep(struct ledSeq *q)
+{
+  while (q->nsteps > 0)
+  {
+    struct ledStep *s = &q->steps[q->head];
+    if (s->level >= 0)
+    {
+      pwmSet(s->pin, s->level);
+      if (s->offMs > 0)
+      {
+        q->state = LED_OFF;
+        q->blinksLeft = 1;
+        armTick(q, s->offMs);
+        return;
+      }
+    }
+    else if (s->pin < 0)
+    { // a pause
+      q->state = LED_OFF;
+      q->blinksLeft = 1;
+      armTick(q, s->offMs);
+      return;
+    }
+    else if (s->count > 0)
+    {
+      writeLED(s->gpio, s->pin, HIGH);
+      q->state = LED_ON;
+      q->blinksLeft = s->count;
+      armTick(q, s->onMs);
+      return;
+    }
+    q->head = (q->head + 1) % MAX_LED_STEPS;
+    q->nsteps--;
+  }
+
+  q->state = LED_IDLE;
+}
+
+/* the on or off time of the head step of the sequencer @arg@ is over */
+static void ledTick(void *arg)
+{
+  struct ledSeq *q = arg;
+  struct ledStep *s = &q->steps[q->head];
+
+  q->timer = -1;
+  if (q->state == LED_ON)
+  {
+    writeLED(s->gpio, s->pin, LOW);
+    q->state = LED_OFF;
+    armTick(q, s->offMs);
+  }
+  else if (--q->blinksLeft > 0)
+  {
+    writeLED(s->gpio, s->pin, HIGH);
+    q->state = LED_ON;
+    armTick(q, s->onMs);
+  }
+  else
+  {
+    q->head = (q->head + 1) % MAX_LED_STEPS;
+    q->nsteps--;
+    startStep(q);
+    if (q->state == LED_IDLE && q->onIdle != NULL)
+    {
+      void (*fn)(void *arg) = q->onIdle;
+      q->onIdle = NULL;
+      fn(q->idleArg);
+    }
+  }
+}
+
+static void enqueue(struct ledSeq *q, uint32_t *gpio, int pin, int onMs, int offMs, int count, int level)
+{
+  struct ledStep *s;
+
+  if (q->nsteps == MAX_LED_STEPS)
+  { // a signal is lost, but the game goes on
+    fprintf(stderr, "led: more than %d queued steps, step dropped\n", MAX_LED_STEPS);
+    return;
+  }
+
+  s = &q->steps[(q->head + q->nsteps) % MAX_LED_STEPS];
+  s->gpio = gpio;
+  s->pin = pin;
+  s->onMs = onMs;
+  s->offMs = offMs;
+  s->count = count;
+  s->level = level;
+  q->nsteps++;
+
+  if (q->state == LED_IDLE)
+    startStep(q);
+}
+
+void ledEnqueue(struct ledSeq *seq, uint32_t *gpio, int pin, int onMs, int offMs, int count)
+{
+  enqueue(seq, gpio, pin, onMs, offMs, count, -1);
+}
+
+void ledEnqueueLevel(struct ledSeq *seq, uint32_t *gpio, int pin, int level, int holdMs)
+{
+  enqueue(seq, gpio, pin, 0, holdMs, 1, level);
+}
+
+void ledOnIdle(struct ledSeq *seq, void (*fn)(void *arg), void *arg)
+{
+  if (seq->state == LED_IDLE)
+  {
+    fn(arg);
+    return;
+  }
+  seq->onIdle = fn;
+  seq->idleArg = arg;
+}
+
+int ledBusy(struct ledSeq *seq)
+{
+  return seq->state != LED_IDLE;
+}
+
+void ledWait(struct ledSeq *seq)
+{
+  while (ledBusy(seq))
+    loopRunOnce(-1);
+}
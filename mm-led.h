@@ -0,0 +1,65 @@
+/* ***************************************************************************** */
+/* Non-blocking LED sequencer: blink patterns are queued as steps and played out */
+/* by timers of the event loop (mm-loop.c), so the game keeps running while the  */
+/* LEDs animate. Steps are played one after the other, in the order queued; a    */
+/* step either blinks an LED, or sets its brightness on the PWM thread of        */
+/* mm-pwm.c.                                                                     */
+/* ***************************************************************************** */
+
+#ifndef MM_LED_H
+#define MM_LED_H
+
+#include <stdint.h>
+
+// largest number of queued steps; more are dropped
+#define MAX_LED_STEPS 64
+
+struct ledStep
+{
+  uint32_t *gpio;
+  int pin, onMs, offMs, count;
+  int level; // >= 0 for a PWM step, which holds for offMs
+};
+
+/* state of the step being played */
+enum ledState
+{
+  LED_IDLE, // nothing is played
+  LED_ON,   // the LED is on, for onMs
+  LED_OFF   // the LED is off (or a pause), for offMs
+};
+
+/* a sequencer; each has its own queue and timers, so several play at once; */
+/* zero-initialised, it is idle                                              */
+struct ledSeq
+{
+  struct ledStep steps[MAX_LED_STEPS]; // a ring; the head is the step being played
+  int head, nsteps;
+  enum ledState state;
+  int blinksLeft;
+  int timer;                 // loop timer of the step being played
+  void (*onIdle)(void *arg); // called once the last step has been played, see ledOnIdle()
+  void *idleArg;
+};
+
+/* queue a step on @seq@: blink @pin@ @count@ times, on for @onMs@ and then off for */
+/* @offMs@ milli-seconds each time; a @pin@ < 0 is a pause of @offMs@; @gpio@ is    */
+/* the mmaped GPIO base address                                                     */
+void ledEnqueue(struct ledSeq *seq, uint32_t *gpio, int pin, int onMs, int offMs, int count);
+
+/* queue a step on @seq@: drive @pin@ at the PWM brightness @level@ (0..PWM_LEVELS, */
+/* see mm-pwm.h), and go on with the next step after @holdMs@ milli-seconds; the    */
+/* level stays until a later step changes it                                        */
+void ledEnqueueLevel(struct ledSeq *seq, uint32_t *gpio, int pin, int level, int holdMs);
+
+/* call @fn@(@arg@) from the event loop once all steps queued on @seq@ have been */
+/* played, or at once if it is idle; for state machines that can't ledWait()     */
+void ledOnIdle(struct ledSeq *seq, void (*fn)(void *arg), void *arg);
+
+/* non-zero while steps of @seq@ are being played */
+int ledBusy(struct ledSeq *seq);
+
+/* run the event loop until all queued steps of @seq@ have been played */
+void ledWait(struct ledSeq *seq);
+
+#endif
@@ -0,0 +1,279 @@
+/* ***************************************************************************** */
+/* Event loop on timerfd and epoll, or on the virtual clock; see mm-loop.h.      */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "mm-clock.h"
+#include "mm-loop.h"
+#include "mm-rt.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+// epoll tag of the timerfd; descriptors are tagged with their slot
+#define TIMER_TAG MAX_FDS
+
+int failure(int fatal, const char *message, ...);
+
+struct timer
+{
+  int used;
+  uint64_t t, period; // next deadline and period, in clock micro-seconds
+  uint64_t seq;       // timers due at the same time fire in the order they were added
+  loop_fn fn;
+  void *arg;
+};
+
+struct watch
+{
+  int fd; // -1 if the slot is free
+  loop_fn fn;
+  void *arg;
+};
+
+static struct timer timers[MAX_TIMERS];
+static struct watch watches[MAX_FDS];
+static uint64_t nextSeq = 0;
+static int epfd = -1, tfd = -1;
+
+/* ======================================================= */
+/* SECTION: set-up                                         */
+/* ------------------------------------------------------- */
+
+/* create the epoll instance and the timerfd on first use */
+static void loopInit(void)
+{
+  struct epoll_event ev;
+
+  if (epfd >= 0)
+    return;
+
+  for (int i = 0; i < MAX_FDS; i++)
+    watches[i].fd = -1;
+
+  if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    failure(TRUE, "loop: epoll_create1 failed: %s\n", strerror(errno));
+  // the real clock is CLOCK_MONOTONIC
+  if ((tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+    failure(TRUE, "loop: timerfd_create failed: %s\n", strerror(errno));
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = TIMER_TAG;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev) != 0)
+    failure(TRUE, "loop: epoll_ctl failed: %s\n", strerror(errno));
+}
+
+/* ======================================================= */
+/* SECTION: timers                                         */
+/* ------------------------------------------------------- */
+
+int loopAddTimer(uint64_t us, uint64_t periodUs, loop_fn fn, void *arg)
+{
+  loopInit();
+
+  for (int id = 0; id < MAX_TIMERS; id++)
+  {
+    if (timers[id].used)
+      continue;
+    timers[id].used = 1;
+    timers[id].t = clockNow() + us;
+    timers[id].period = periodUs;
+    timers[id].seq = nextSeq++;
+    timers[id].fn = fn;
+    timers[id].arg = arg;
+    return id;
+  }
+
+  return -1;
+}
+
+void loopCancelTimer(int id)
+{
+  if (id >= 0 && id < MAX_TIMERS)
+    timers[id].used = 0;
+}
+
+/* the timer that is due first, or -1 if there is none */
+static int firstTimer(void)
+{
+  int first = -1;
+
+  for (int id = 0; id < MAX_TIMERS; id++)
+    if (timers[id].used && (first < 0 || timers[id].t < timers[first].t ||
+                            (timers[id].t == timers[first].t && timers[id].seq < timers[first].seq)))
+      first = id;
+
+  return first;
+}
+
+/* run the handlers of all timers due by now, in deadline order; returns how many ran; */
+/* if @record@, their lateness goes into the wake-up histogram of mm-rt.c              */
+static int fireTimers(int record)
+{
+  uint64_t now = clockNow();
+  int id, n = 0;
+
+  while ((id = firstTimer()) >= 0 && timers[id].t <= now)
+  {
+    struct timer *tm = &timers[id];
+    if (record)
+      rtRecordWake(WAKE_TIMER, (int64_t)(now - tm->t) * 1000);
+    if (tm->period != 0)
+    { // a periodic timer that fell behind fires once per loopRunOnce until it caught up
+      tm->t += tm->period;
+      tm->seq = nextSeq++;
+    }
+    else
+      tm->used = 0;
+    tm->fn(tm->arg);
+    n++;
+  }
+
+  return n;
+}
+
+/* ======================================================= */
+/* SECTION: descriptors                                    */
+/* ------------------------------------------------------- */
+
+int loopAddFd(int fd, loop_fn fn, void *arg)
+{
+  struct epoll_event ev;
+
+  loopInit();
+
+  for (int i = 0; i < MAX_FDS; i++)
+  {
+    if (watches[i].fd >= 0)
+      continue;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+      return -1;
+    watches[i].fd = fd;
+    watches[i].fn = fn;
+    watches[i].arg = arg;
+    return 0;
+  }
+
+  errno = ENOSPC;
+  return -1;
+}
+
+void loopRemoveFd(int fd)
+{
+  for (int i = 0; i < MAX_FDS; i++)
+  {
+    if (watches[i].fd != fd)
+      continue;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    watches[i].fd = -1;
+  }
+}
+
+/* ======================================================= */
+/* SECTION: dispatch                                       */
+/* ------------------------------------------------------- */
+
+/* real clock: one epoll_wait on the descriptors and the timerfd, armed for the first deadline */
+static int runReal(int timeoutMs)
+{
+  struct epoll_event evs[MAX_FDS + 1];
+  struct itimerspec its;
+  int first = firstTimer(), n, ran = 0;
+
+  memset(&its, 0, sizeof(its));
+  if (first >= 0)
+  { // an absolute deadline in the past fires at once; 0 would disarm the timer
+    uint64_t t = timers[first].t ? timers[first].t : 1;
+    its.it_value.tv_sec = (time_t)(t / 1000000);
+    its.it_value.tv_nsec = (long)(t % 1000000) * 1000;
+  }
+  timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+
+  if ((n = epoll_wait(epfd, evs, MAX_FDS + 1, timeoutMs)) < 0)
+    return 0; // EINTR
+
+  for (int i = 0; i < n; i++)
+  {
+    uint32_t tag = evs[i].data.u32;
+    if (tag == TIMER_TAG)
+    {
+      uint64_t expirations;
+      if (read(tfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        failure(TRUE, "loop: read of timerfd failed: %s\n", strerror(errno));
+      ran += fireTimers(1);
+    }
+    else if (watches[tag].fd >= 0)
+    {
+      watches[tag].fn(watches[tag].arg);
+      ran++;
+    }
+  }
+
+  return ran;
+}
+
+/* virtual clock: poll the descriptors without waiting; if none is readable, */
+/* advance the clock to the first deadline, or by @timeoutMs@                */
+static int runVirtual(int timeoutMs)
+{
+  struct pollfd pfds[MAX_FDS];
+  int slot[MAX_FDS], nfds = 0, ran = 0, first;
+
+  for (int i = 0; i < MAX_FDS; i++)
+  {
+    if (watches[i].fd < 0)
+      continue;
+    pfds[nfds].fd = watches[i].fd;
+    pfds[nfds].events = POLLIN;
+    pfds[nfds].revents = 0;
+    slot[nfds++] = i;
+  }
+  if (nfds > 0 && poll(pfds, nfds, 0) > 0)
+  {
+    for (int i = 0; i < nfds; i++)
+    {
+      if ((pfds[i].revents & (POLLIN | POLLHUP)) && watches[slot[i]].fd >= 0)
+      {
+        watches[slot[i]].fn(watches[slot[i]].arg);
+        ran++;
+      }
+    }
+    return ran;
+  }
+
+  uint64_t now = clockNow();
+  if ((first = firstTimer()) >= 0 && (timeoutMs < 0 || timers[first].t <= now + (uint64_t)timeoutMs * 1000))
+  {
+    if (timers[first].t > now)
+      clockSleep(timers[first].t - now);
+    return fireTimers(0);
+  }
+  if (timeoutMs > 0)
+    clockSleep((uint64_t)timeoutMs * 1000);
+
+  return 0;
+}
+
+int loopRunOnce(int timeoutMs)
+{
+  loopInit();
+
+  if (strcmp(clockName(), "virtual") == 0)
+    return runVirtual(timeoutMs);
+  return runReal(timeoutMs);
+}
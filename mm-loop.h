@@ -0,0 +1,42 @@
+/* ***************************************************************************** */
+/* Single-threaded event loop: timers and file descriptors (button events,      */
+/* stdin), dispatched from loopRunOnce() in the thread that calls it.            */
+/*                                                                               */
+/* With the real clock, all timers share one timerfd, armed for the earliest     */
+/* deadline, and are waited on with epoll together with the descriptors. With    */
+/* the virtual clock, the loop polls the descriptors without waiting and then    */
+/* advances the clock to the earliest deadline. Handlers run in normal context,  */
+/* so they may call anything.                                                    */
+/* ***************************************************************************** */
+
+#ifndef MM_LOOP_H
+#define MM_LOOP_H
+
+#include <stdint.h>
+
+// largest number of timers and of descriptors registered at the same time
+#define MAX_TIMERS 32
+#define MAX_FDS 8
+
+/* handler of a timer or descriptor */
+typedef void (*loop_fn)(void *arg);
+
+/* call @fn@(@arg@) @us@ micro-seconds from now, and then every @periodUs@ unless */
+/* that is 0; returns the timer's id (>= 0), or -1 if all timers are in use       */
+int loopAddTimer(uint64_t us, uint64_t periodUs, loop_fn fn, void *arg);
+
+/* cancel timer @id@; ignored if it has fired (and is not periodic) already */
+void loopCancelTimer(int id);
+
+/* call @fn@(@arg@) whenever @fd@ is readable; returns 0, or -1 with errno set */
+int loopAddFd(int fd, loop_fn fn, void *arg);
+
+/* stop watching @fd@ */
+void loopRemoveFd(int fd);
+
+/* wait until a timer is due or a descriptor readable, up to @timeoutMs@    */
+/* milli-seconds (-1 for ever), and run the handlers of all that are; returns */
+/* the number of handlers run                                                 */
+int loopRunOnce(int timeoutMs);
+
+#endif
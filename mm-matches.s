@@ -1 +1,2 @@
-@ Implemented as inline assembly in master-mind.c
+# Implemented as inline assembly in master-mind.c
+	.section .note.GNU-stack,"",%progbits
@@ -0,0 +1,201 @@
+/* ***************************************************************************** */
+/* Software PWM thread on the LED pins; see mm-pwm.h.                            */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mm-clock.h"
+#include "mm-pwm.h"
+#include "mm-rt.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+#define LOW 0
+#define HIGH 1
+
+int failure(int fatal, const char *message, ...);
+void writeLED(uint32_t *gpio, int led, int value);
+void writePins(uint32_t *gpio, uint32_t setMask, uint32_t clearMask);
+
+#define PERIOD_NS (1000000000L / PWM_FREQ)
+#define LEVEL_NS (PERIOD_NS / PWM_LEVELS)
+
+static uint32_t *pwmGPIO = NULL;
+static int running = 0;
+
+/* the pins and their levels; the thread takes a copy at the start of each period */
+static int pins[MAX_PWM_PINS], levels[MAX_PWM_PINS];
+static int npins = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+/* counts the copies taken, so pwmSet() knows when a pin is no longer driven */
+static uint64_t periods = 0;
+static pthread_cond_t tick = PTHREAD_COND_INITIALIZER;
+
+/* ======================================================= */
+/* SECTION: thread                                         */
+/* ------------------------------------------------------- */
+
+static void addNs(struct timespec *t, long ns)
+{
+  t->tv_nsec += ns;
+  while (t->tv_nsec >= 1000000000)
+  {
+    t->tv_nsec -= 1000000000;
+    t->tv_sec++;
+  }
+}
+
+/* sleep until @t@ on CLOCK_MONOTONIC, and record how late it woke up */
+static void sleepUntil(const struct timespec *t)
+{
+  struct timespec woke;
+
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, t, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &woke);
+  rtRecordWake(WAKE_PWM, (int64_t)(woke.tv_sec - t->tv_sec) * 1000000000 + (woke.tv_nsec - t->tv_nsec));
+}
+
+/* one period: the pins with a level go on together, and each goes off after its level; */
+/* pins at level 0 are left alone, for writeLED                                         */
+static void *pwmThread(void *arg)
+{
+  struct timespec start, t;
+  int lv[MAX_PWM_PINS], n;
+  sigset_t all;
+
+  (void)arg;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+  rtBoostThread(1); // above the game loop, whose busy stretches would delay its edges
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (;;)
+  {
+    uint32_t set = 0;
+    int idle;
+
+    pthread_mutex_lock(&lock);
+    for (;;)
+    {
+      periods++;
+      pthread_cond_broadcast(&tick);
+      n = npins;
+      memcpy(lv, levels, sizeof(lv));
+      idle = 1;
+      for (int i = 0; i < n; i++)
+        if (lv[i] > 0)
+          idle = 0;
+      if (!idle)
+        break;
+      // nothing to drive: wait without using the CPU
+      pthread_cond_wait(&wake, &lock);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+    }
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < n; i++)
+      if (lv[i] > 0)
+        set |= 1u << pins[i];
+    writePins(pwmGPIO, set, 0);
+
+    // switch the pins off in the order of their levels; equal levels go off together,
+    // and pins at PWM_LEVELS stay on for the whole period
+    for (;;)
+    {
+      int next = PWM_LEVELS;
+      uint32_t off = 0;
+
+      for (int i = 0; i < n; i++)
+        if (lv[i] > 0 && lv[i] < next)
+          next = lv[i];
+      if (next == PWM_LEVELS)
+        break;
+      for (int i = 0; i < n; i++)
+      {
+        if (lv[i] == next)
+        {
+          off |= 1u << pins[i];
+          lv[i] = 0;
+        }
+      }
+      t = start;
+      addNs(&t, next * LEVEL_NS);
+      sleepUntil(&t);
+      writePins(pwmGPIO, 0, off);
+    }
+
+    addNs(&start, PERIOD_NS);
+    sleepUntil(&start);
+  }
+
+  return NULL;
+}
+
+/* ======================================================= */
+/* SECTION: interface                                      */
+/* ------------------------------------------------------- */
+
+int pwmStart(uint32_t *gpio)
+{
+  pthread_t thread;
+
+  pwmGPIO = gpio;
+  if (strcmp(clockName(), "virtual") == 0)
+    return 0;
+
+  if ((errno = pthread_create(&thread, NULL, pwmThread, NULL)) != 0)
+    return -1;
+  pthread_detach(thread);
+  running = 1;
+
+  return 0;
+}
+
+void pwmSet(int pin, int level)
+{
+  int i;
+
+  if (pin < 0 || pin > 31)
+    failure(TRUE, "pwm: pin %d not supported\n", pin);
+  if (level < 0)
+    level = 0;
+  if (level > PWM_LEVELS)
+    level = PWM_LEVELS;
+
+  if (!running)
+  { // no thread: on or off
+    writeLED(pwmGPIO, pin, (level > 0) ? HIGH : LOW);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  for (i = 0; i < npins && pins[i] != pin; i++)
+    ;
+  if (i == npins)
+  {
+    if (npins == MAX_PWM_PINS)
+      failure(TRUE, "pwm: more than %d pins\n", MAX_PWM_PINS);
+    pins[npins++] = pin;
+  }
+  levels[i] = level;
+  pthread_cond_signal(&wake);
+  if (level == 0)
+  { // once the thread took a copy without the pin, it doesn't touch it any more
+    uint64_t seen = periods;
+    while (periods == seen)
+      pthread_cond_wait(&tick, &lock);
+    writeLED(pwmGPIO, pin, LOW);
+  }
+  pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,28 @@
+/* ***************************************************************************** */
+/* Software PWM on the LED pins: a thread switches each pin on at the start of   */
+/* every period and off after its share of it, so an LED shows a brightness      */
+/* level instead of just on or off. Used by the compact feedback mode (-F pwm).  */
+/* On the virtual clock there is no thread; any level above 0 is fully on.       */
+/* ***************************************************************************** */
+
+#ifndef MM_PWM_H
+#define MM_PWM_H
+
+#include <stdint.h>
+
+// PWM frequency in Hz, well above what the eye resolves as flicker
+#define PWM_FREQ 200
+// brightness levels: 0 is off, PWM_LEVELS fully on; one level lasts 1/(PWM_FREQ*PWM_LEVELS) s
+#define PWM_LEVELS 64
+// largest number of pins driven
+#define MAX_PWM_PINS 8
+
+/* start the PWM thread on the mmaped @gpio@ block; returns 0, or -1 with errno set */
+int pwmStart(uint32_t *gpio);
+
+/* drive @pin@ (0..31) at brightness @level@ (0..PWM_LEVELS) from the next period on; */
+/* level 0 waits for the period to end and switches the pin off, after which it is    */
+/* free for writeLED                                                                  */
+void pwmSet(int pin, int level);
+
+#endif
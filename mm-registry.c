@@ -0,0 +1,315 @@
+/* ***************************************************************************** */
+/* Registry of all scoring kernels, with a self-check and a short benchmark at   */
+/* startup that binds the fastest correct kernel for the configuration.          */
+/* Set MM_KERNEL / MM_BATCH_KERNEL to a kernel name to force that kernel; if    */
+/* either variable is set (to anything), the measurements are printed to stderr. */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mm-score.h"
+
+// length of one benchmark run, in nano-seconds: 2ms
+#define BENCH_NS 2000000
+// number of random pairs used for the self-check and the benchmark
+#define SAMPLE_PAIRS 4096
+// number of codes in the set used for benchmarking the batch kernels
+#define SAMPLE_CODES 1024
+
+/* configuration the kernels are registered for */
+static int regLen = 0, regCols = 0;
+
+/* ======================================================= */
+/* SECTION: kernels with the score_fn signature            */
+/* ------------------------------------------------------- */
+
+static struct matches referenceKernel(const int *seq1, const int *seq2)
+{
+  return scoreMatches(seq1, seq2, regLen, regCols);
+}
+
+#if defined(__arm__)
+static struct matches asmKernel(const int *seq1, const int *seq2)
+{
+  int data[2];
+  struct matches res;
+
+  countMatches_asm((int *)seq1, (int *)seq2, regLen, data);
+  res.exact = data[0];
+  res.approx = data[1];
+  return res;
+}
+#endif
+
+static struct kernelInfo scoreRegistry[] = {
+    {"reference", NULL, 0, 0, 0.0},
+    {"unrolled", NULL, 0, 0, 0.0},
+    {"table", NULL, 0, 0, 0.0},
+    {"asm", NULL, 0, 0, 0.0},
+};
+
+static struct batchKernelInfo batchRegistry[] = {
+    {"scalar", NULL, 0, 0, 0.0},
+    {"sse2", NULL, 0, 0, 0.0},
+    {"avx2", NULL, 0, 0, 0.0},
+    {"neon", NULL, 0, 0, 0.0},
+};
+
+#define N_SCORE (int)(sizeof(scoreRegistry) / sizeof(scoreRegistry[0]))
+#define N_BATCH (int)(sizeof(batchRegistry) / sizeof(batchRegistry[0]))
+
+/* fill in the kernels that this build, CPU and configuration support */
+static void registerKernels(int len, int cols)
+{
+  regLen = len;
+  regCols = cols;
+
+  scoreRegistry[0].fn = referenceKernel;
+  scoreRegistry[1].fn = unrolledKernel(len);
+  scoreRegistry[2].fn = tableKernel(len, cols);
+#if defined(__arm__)
+  scoreRegistry[3].fn = asmKernel;
+#endif
+
+  batchRegistry[0].fn = countMatchesBatch_scalar;
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  batchRegistry[1].fn = countMatchesBatch_sse2;
+  if (__builtin_cpu_supports("avx2"))
+    batchRegistry[2].fn = countMatchesBatch_avx2;
+#endif
+#if defined(__ARM_NEON)
+  batchRegistry[3].fn = countMatchesBatch_neon;
+#endif
+}
+
+/* ======================================================= */
+/* SECTION: self-check and benchmark                       */
+/* ------------------------------------------------------- */
+
+static uint64_t nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* @n@ pairs of sequences, stored one after the other; all entries are colours  */
+/* 1..regCols, the contract of the kernels (see scoreMatches). The first pairs   */
+/* are made of the extreme colours 1 and regCols only, where a kernel that gets  */
+/* the range wrong shows first; the rest are random, from a generator of their  */
+/* own: srand() here would make every later rand() of the program, such as the  */
+/* random secrets, the same on each run                                          */
+static int *samplePairs(int n)
+{
+  int *seqs = (int *)malloc((size_t)n * 2 * regLen * sizeof(int));
+  int edges = (n < 4) ? n : 4;
+  uint32_t x = 1701; // xorshift32 state; fixed, so the sample is the same on each run
+
+  for (int i = 0; i < n * 2 * regLen; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seqs[i] = x % regCols + 1;
+  }
+  for (int i = 0; i < edges * 2 * regLen; i++)
+  {
+    int pair = i / (2 * regLen), second = (i / regLen) % 2, peg = i % regLen;
+    // all 1 against all regCols, both all regCols, and two alternating patterns
+    int low = (pair == 0) ? !second : (pair == 1) ? 0 : ((peg + second + pair) % 2);
+    seqs[i] = low ? 1 : regCols;
+  }
+
+  return seqs;
+}
+
+static int checkKernel(score_fn fn, const int *seqs, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    const int *seq1 = seqs + 2 * i * regLen, *seq2 = seq1 + regLen;
+    struct matches res = fn(seq1, seq2);
+    struct matches ref = scoreMatches(seq1, seq2, regLen, regCols);
+    if (res.exact != ref.exact || res.approx != ref.approx)
+      return 0;
+  }
+
+  return 1;
+}
+
+/* run @fn@ over all pairs, doubling the repetitions until one run takes BENCH_NS */
+static double benchKernel(score_fn fn, const int *seqs, int n)
+{
+  volatile int sink = 0;
+  uint64_t t = 0;
+  long reps = 1;
+
+  for (;; reps *= 2)
+  {
+    uint64_t t0 = nowNs();
+    for (long r = 0; r < reps; r++)
+      for (int i = 0; i < n; i++)
+        sink += fn(seqs + 2 * i * regLen, seqs + (2 * i + 1) * regLen).exact;
+    t = nowNs() - t0;
+    if (t >= BENCH_NS)
+      break;
+  }
+
+  return (double)t / ((double)reps * n);
+}
+
+static int checkBatchKernel(batch_fn fn, const struct codeSet *set, const int *seqs, int n)
+{
+  unsigned char *out = (unsigned char *)malloc(set->n);
+  int code[MAX_SEQL], ok = 1;
+
+  for (int g = 0; g < n && ok; g++)
+  {
+    fn(seqs + g * regLen, set, out);
+    for (int k = 0; k < set->n && ok; k++)
+    {
+      for (int p = 0; p < regLen; p++)
+        code[p] = set->pegs[(size_t)p * set->stride + k];
+      struct matches ref = scoreMatches(code, seqs + g * regLen, regLen, regCols);
+      ok = (out[k] == PACK_MATCHES(ref, regLen));
+    }
+  }
+
+  free(out);
+  return ok;
+}
+
+/* ns per scored code */
+static double benchBatchKernel(batch_fn fn, const struct codeSet *set, const int *seqs, int n)
+{
+  unsigned char *out = (unsigned char *)malloc(set->n);
+  uint64_t t = 0;
+  long reps = 1;
+
+  for (;; reps *= 2)
+  {
+    uint64_t t0 = nowNs();
+    for (long r = 0; r < reps; r++)
+      fn(seqs + (r % n) * regLen, set, out);
+    t = nowNs() - t0;
+    if (t >= BENCH_NS)
+      break;
+  }
+
+  free(out);
+  return (double)t / ((double)reps * set->n);
+}
+
+/* ======================================================= */
+/* SECTION: binding                                        */
+/* ------------------------------------------------------- */
+
+score_fn bindKernel(int len, int cols)
+{
+  const char *force = getenv("MM_KERNEL");
+  const char *forceBatch = getenv("MM_BATCH_KERNEL");
+  int verbose = (force != NULL || forceBatch != NULL);
+  int best = -1, bestBatch = -1;
+  int *seqs;
+  struct codeSet *set;
+
+  if (len < 1 || len > MAX_SEQL || cols < 1 || cols > MAX_COLS)
+    return NULL;
+
+  registerKernels(len, cols);
+  seqs = samplePairs(SAMPLE_PAIRS);
+
+  for (int i = 0; i < N_SCORE; i++)
+  {
+    struct kernelInfo *k = &scoreRegistry[i];
+    k->available = (k->fn != NULL);
+    if (!k->available)
+      continue;
+    k->ok = checkKernel(k->fn, seqs, SAMPLE_PAIRS);
+    k->ns = benchKernel(k->fn, seqs, SAMPLE_PAIRS);
+    if (k->ok && (best < 0 || k->ns < scoreRegistry[best].ns))
+      best = i;
+  }
+  if (force != NULL)
+  {
+    int i = 0;
+    while (i < N_SCORE && !(scoreRegistry[i].available && strcmp(force, scoreRegistry[i].name) == 0))
+      i++;
+    if (i < N_SCORE)
+      best = i;
+    else
+      fprintf(stderr, "registry: MM_KERNEL=%s is no kernel available here; binding the fastest\n", force);
+  }
+
+  /* the batch kernels are checked and timed on a set of random codes */
+  set = newCodeSet(SAMPLE_CODES, len, cols);
+  for (int k = 0; k < SAMPLE_CODES; k++)
+    setCode(set, k, seqs + k * len);
+
+  for (int i = 0; i < N_BATCH; i++)
+  {
+    struct batchKernelInfo *k = &batchRegistry[i];
+    k->available = (k->fn != NULL);
+    if (!k->available)
+      continue;
+    k->ok = checkBatchKernel(k->fn, set, seqs + SAMPLE_CODES * len, 16);
+    k->ns = benchBatchKernel(k->fn, set, seqs, SAMPLE_PAIRS);
+    if (k->ok && (bestBatch < 0 || k->ns < batchRegistry[bestBatch].ns))
+      bestBatch = i;
+  }
+  if (forceBatch != NULL)
+  {
+    int i = 0;
+    while (i < N_BATCH && !(batchRegistry[i].available && strcmp(forceBatch, batchRegistry[i].name) == 0))
+      i++;
+    if (i < N_BATCH)
+      bestBatch = i;
+    else
+      fprintf(stderr, "registry: MM_BATCH_KERNEL=%s is no batch kernel available here; binding the fastest\n",
+              forceBatch);
+  }
+  setBatchKernel(batchRegistry[bestBatch].fn);
+
+  if (verbose)
+  {
+    for (int i = 0; i < N_SCORE; i++)
+    {
+      struct kernelInfo *k = &scoreRegistry[i];
+      if (k->available)
+        fprintf(stderr, "kernel %-10s %8.2f ns/op%s%s\n", k->name, k->ns, k->ok ? "" : "  WRONG",
+                i == best ? "  <- bound" : "");
+      else
+        fprintf(stderr, "kernel %-10s unavailable\n", k->name);
+    }
+    for (int i = 0; i < N_BATCH; i++)
+    {
+      struct batchKernelInfo *k = &batchRegistry[i];
+      if (k->available)
+        fprintf(stderr, "batch  %-10s %8.2f ns/code%s%s\n", k->name, k->ns, k->ok ? "" : "  WRONG",
+                i == bestBatch ? "  <- bound" : "");
+      else
+        fprintf(stderr, "batch  %-10s unavailable\n", k->name);
+    }
+  }
+
+  freeCodeSet(set);
+  free(seqs);
+  return scoreRegistry[best].fn;
+}
+
+const struct kernelInfo *scoreKernelList(int *n)
+{
+  *n = N_SCORE;
+  return scoreRegistry;
+}
+
+const struct batchKernelInfo *batchKernelList(int *n)
+{
+  *n = N_BATCH;
+  return batchRegistry;
+}
@@ -0,0 +1,56 @@
+/* ***************************************************************************** */
+/* Lock-free single-producer/single-consumer ring of input events.               */
+/* The producer only writes tail, the consumer only head; each index lives on    */
+/* its own cache line, and the slots are published with release/acquire order.   */
+/* ***************************************************************************** */
+
+#ifndef MM_RING_H
+#define MM_RING_H
+
+#include <stdint.h>
+
+// number of slots; a power of 2
+#define RING_SIZE 256
+
+/* a change of a button's level, time-stamped with the clock of mm-clock.c */
+struct inputEvent
+{
+  uint64_t t;  // micro-seconds
+  int pressed; // 1 for a press, 0 for a release
+  int pin;     // the button's
+};
+
+struct ring
+{
+  _Alignas(64) unsigned int head; // next slot to read; written by the consumer
+  _Alignas(64) unsigned int tail; // next slot to write; written by the producer
+  _Alignas(64) struct inputEvent slot[RING_SIZE];
+};
+
+/* producer: append @ev@; returns 0 if the ring is full (the event is dropped) */
+static inline int ringPush(struct ring *r, const struct inputEvent *ev)
+{
+  unsigned int tail = r->tail; // only the producer writes it
+  unsigned int head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+  if (tail - head == RING_SIZE)
+    return 0;
+  r->slot[tail % RING_SIZE] = *ev;
+  __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/* consumer: take the oldest event into @ev@; returns 0 if the ring is empty */
+static inline int ringPop(struct ring *r, struct inputEvent *ev)
+{
+  unsigned int head = r->head; // only the consumer writes it
+  unsigned int tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+  if (head == tail)
+    return 0;
+  *ev = r->slot[head % RING_SIZE];
+  __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+#endif
@@ -0,0 +1,165 @@
+/* ***************************************************************************** */
+/* Real-time set-up and wake-up jitter histograms; see mm-rt.h.                  */
+/* ***************************************************************************** */
+
+#define _GNU_SOURCE // CPU_SET and pthread_setaffinity_np
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "mm-rt.h"
+
+static const char *sourceNames[WAKE_COUNT] = {"sleep", "timer", "sampler", "pwm"};
+
+/* one writer per source: sleep and timer in the game loop, sampler and pwm in their threads */
+struct wakeStats
+{
+  uint64_t n, sumNs, maxNs;
+  uint64_t bucket[WAKE_BUCKETS];
+};
+
+static struct wakeStats stats[WAKE_COUNT];
+static int enabled = 0;
+static int rtCpu = -1;
+// the CPUs of the process before rtSetup() pinned it, for rtPlainThread()
+static cpu_set_t plainSet;
+
+/* ======================================================= */
+/* SECTION: real-time mode                                 */
+/* ------------------------------------------------------- */
+
+/* pin the calling thread to rtCpu, if one is given */
+static int pinThread(void)
+{
+  cpu_set_t set;
+
+  if (rtCpu < 0)
+    return 0;
+  CPU_ZERO(&set);
+  CPU_SET(rtCpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+int rtSetup(int cpu)
+{
+  struct sched_param sp;
+
+  // no page faults in the timing-critical paths: lock what is mapped now and later
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    return -1;
+
+  if ((errno = pthread_getaffinity_np(pthread_self(), sizeof(plainSet), &plainSet)) != 0)
+    return -1;
+  rtCpu = cpu;
+  if ((errno = pinThread()) != 0)
+    return -1;
+
+  memset(&sp, 0, sizeof(sp));
+  sp.sched_priority = RT_PRIO;
+  if ((errno = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) != 0)
+    return -1;
+
+  enabled = 1;
+  return 0;
+}
+
+void rtBoostThread(int boost)
+{
+  struct sched_param sp;
+
+  if (!enabled)
+    return;
+  pinThread();
+  memset(&sp, 0, sizeof(sp));
+  sp.sched_priority = RT_PRIO + boost;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+}
+
+void rtPlainThread(void)
+{
+  struct sched_param sp;
+
+  if (!enabled)
+    return;
+  memset(&sp, 0, sizeof(sp));
+  pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+  pthread_setaffinity_np(pthread_self(), sizeof(plainSet), &plainSet);
+}
+
+int rtEnabled(void)
+{
+  return enabled;
+}
+
+/* ======================================================= */
+/* SECTION: histograms                                     */
+/* ------------------------------------------------------- */
+
+void rtRecordWake(enum wakeSource src, int64_t lateNs)
+{
+  struct wakeStats *s = &stats[src];
+  uint64_t late = (lateNs > 0) ? (uint64_t)lateNs : 0;
+  uint64_t us = late / 1000;
+  int b = 0;
+
+  while (us > 0 && b < WAKE_BUCKETS - 1)
+  {
+    us >>= 1;
+    b++;
+  }
+
+  s->bucket[b]++;
+  s->n++;
+  s->sumNs += late;
+  if (late > s->maxNs)
+    s->maxNs = late;
+}
+
+/* upper bound of bucket @b@, in micro-seconds */
+static uint64_t bucketLimit(int b)
+{
+  return (uint64_t)1 << b;
+}
+
+/* smallest bucket limit below which at least @q@ of the wake-ups fall */
+static uint64_t quantile(const struct wakeStats *s, double q)
+{
+  uint64_t seen = 0;
+
+  for (int b = 0; b < WAKE_BUCKETS; b++)
+  {
+    seen += s->bucket[b];
+    if (seen >= q * s->n)
+      return bucketLimit(b);
+  }
+
+  return bucketLimit(WAKE_BUCKETS - 1);
+}
+
+void rtReport(FILE *out)
+{
+  fprintf(out, "\nwake-up lateness (%s)\n", enabled ? "real-time mode" : "normal scheduling");
+  for (int src = 0; src < WAKE_COUNT; src++)
+  {
+    const struct wakeStats *s = &stats[src];
+    if (s->n == 0)
+      continue;
+
+    fprintf(out, "%-8s n=%llu mean=%.1fus max=%.1fus p50<%lluus p99<%lluus\n", sourceNames[src],
+            (unsigned long long)s->n, s->sumNs / 1e3 / s->n, s->maxNs / 1e3,
+            (unsigned long long)quantile(s, 0.5), (unsigned long long)quantile(s, 0.99));
+    for (int b = 0; b < WAKE_BUCKETS; b++)
+    {
+      if (s->bucket[b] == 0)
+        continue;
+      fprintf(out, "  %s%8lluus %10llu\n", (b == WAKE_BUCKETS - 1) ? ">=" : " <",
+              (unsigned long long)bucketLimit(b == WAKE_BUCKETS - 1 ? b - 1 : b), (unsigned long long)s->bucket[b]);
+    }
+  }
+}
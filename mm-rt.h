@@ -0,0 +1,55 @@
+/* ***************************************************************************** */
+/* Real-time mode (option -R): locked memory, SCHED_FIFO and a pinned CPU for    */
+/* the game loop and the sampling thread; and histograms of how late they wake   */
+/* up compared to the requested time (option -j prints them).                    */
+/* ***************************************************************************** */
+
+#ifndef MM_RT_H
+#define MM_RT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// SCHED_FIFO priority of the game loop; the PWM thread runs one above it, the
+// sampling thread two above, so both preempt the loop on the CPU they share
+#define RT_PRIO 50
+
+// histogram buckets: bucket 0 counts wake-ups less than 1us late, bucket b
+// those 2^(b-1) to 2^b us late; the last one everything later
+#define WAKE_BUCKETS 24
+
+/* where a wake-up is recorded */
+enum wakeSource
+{
+  WAKE_SLEEP,   // delay() and delayMicroseconds() on the real clock
+  WAKE_TIMER,   // timers of the event loop
+  WAKE_SAMPLER, // periods of the button sampling thread
+  WAKE_PWM,     // edges of the software PWM thread
+  WAKE_COUNT
+};
+
+/* lock all memory, and run the calling thread under SCHED_FIFO at RT_PRIO,     */
+/* pinned to @cpu@ (none if < 0); threads it creates later inherit both, so     */
+/* each of them calls rtBoostThread() or rtPlainThread() first;                 */
+/* returns 0, or -1 with errno set                                              */
+int rtSetup(int cpu);
+
+/* raise the calling thread to RT_PRIO + @boost@, on the CPU of the game loop, */
+/* if real-time mode is on                                                     */
+void rtBoostThread(int boost);
+
+/* run the calling thread under the default policy, on the CPUs the process had */
+/* before rtSetup(), if real-time mode is on; for threads that aren't timing-   */
+/* critical, so that they neither compete with the game loop nor share its CPU  */
+void rtPlainThread(void);
+
+/* non-zero if real-time mode is on */
+int rtEnabled(void);
+
+/* record a wake-up @lateNs@ nano-seconds after the requested time */
+void rtRecordWake(enum wakeSource src, int64_t lateNs);
+
+/* print the histograms of all sources with wake-ups to @out@ */
+void rtReport(FILE *out);
+
+#endif
@@ -0,0 +1,412 @@
+/* ***************************************************************************** */
+/* Scoring kernels for the MasterMind matching function.                         */
+/* countMatches() in master-mind.c and countMatches_C() in testm.c are thin      */
+/* wrappers over scoreMatches() below.                                           */
+/* ***************************************************************************** */
+
+#include <stdlib.h>
+
+#include "mm-score.h"
+
+/* ======================================================= */
+/* SECTION: histogram kernel                               */
+/* ------------------------------------------------------- */
+
+/* Exact matches are counted position by position. Every position that is not an */
+/* exact match adds its colour to a per-colour histogram, one for each sequence; */
+/* the approximate matches are then the sum over all colours of the smaller of   */
+/* the two counts. This is correct for any number of colours and any length,     */
+/* and repeated colours are never counted twice. Entries must be in 1..@cols@,   */
+/* see validSeq(); this is not checked here, on the hot path.                    */
+struct matches scoreMatches(const int *seq1, const int *seq2, int len, int cols)
+{
+  unsigned char hist1[MAX_COLS + 1] = {0};
+  unsigned char hist2[MAX_COLS + 1] = {0};
+  struct matches res = {0, 0};
+
+  for (int i = 0; i < len; i++)
+  {
+    if (seq1[i] == seq2[i])
+    {
+      res.exact++;
+    }
+    else
+    {
+      hist1[seq1[i]]++;
+      hist2[seq2[i]]++;
+    }
+  }
+
+  for (int c = 1; c <= cols; c++)
+  {
+    res.approx += (hist1[c] < hist2[c]) ? hist1[c] : hist2[c];
+  }
+
+  return res;
+}
+
+int validSeq(const int *seq, int len, int cols)
+{
+  for (int i = 0; i < len; i++)
+    if (seq[i] < 1 || seq[i] > cols)
+      return 0;
+  return 1;
+}
+
+/* ======================================================= */
+/* SECTION: feedback lookup table                          */
+/* ------------------------------------------------------- */
+
+/* Scoring is symmetric, so only the lower triangle of the (secret, guess) table  */
+/* is stored, row by row: the pair (i, j) is in cell max*(max+1)/2 + min. Up to    */
+/* TABLE_NIBBLE_LEN pegs there are at most 15 feedbacks, so a cell is a 4-bit code */
+/* that tableFb[] turns back into the packed feedback, two cells a byte; for 6x4   */
+/* that is 410 KB, which stays in L2. Longer codes take a byte per cell.           */
+#define TABLE_NIBBLE_LEN 4
+
+static unsigned char *matchTable = NULL;
+static unsigned char tableFb[16]; // 4-bit code -> packed feedback
+static int tableLen = 0, tableCols = 0;
+
+/* cell of the pair of code indices (@i1@, @i2@) in the triangle */
+static inline size_t tableCell(unsigned int i1, unsigned int i2)
+{
+  unsigned int hi = (i1 > i2) ? i1 : i2, lo = (i1 > i2) ? i2 : i1;
+
+  return (size_t)hi * (hi + 1) / 2 + lo;
+}
+
+/* packed feedback in @cell@ of the table for @len@ pegs */
+static inline int tableGet(size_t cell, int len)
+{
+  if (len <= TABLE_NIBBLE_LEN)
+    return tableFb[(matchTable[cell / 2] >> (cell % 2 * 4)) & 0xf];
+  return matchTable[cell];
+}
+
+int codeSpace(int len, int cols)
+{
+  long n = 1;
+
+  for (int i = 0; i < len; i++)
+  {
+    n *= cols;
+    if (n > 0x7fffffff)
+      return -1;
+  }
+
+  return (int)n;
+}
+
+int seqToIndex(const int *seq, int len, int cols)
+{
+  int idx = 0;
+
+  for (int i = 0; i < len; i++)
+  {
+    /* Accessing the sequence colour by colour, like readSeq() does with digits */
+    if (seq[i] < 1 || seq[i] > cols)
+      return -1;
+    idx = idx * cols + (seq[i] - 1);
+  }
+
+  return idx;
+}
+
+void indexToSeq(int *seq, int idx, int len, int cols)
+{
+  for (int i = len - 1; i >= 0; i--)
+  {
+    seq[i] = idx % cols + 1;
+    idx /= cols;
+  }
+}
+
+int initMatchTable(int len, int cols)
+{
+  int n = codeSpace(len, cols), codes = 0;
+  int seq1[MAX_SEQL], seq2[MAX_SEQL];
+  size_t cells;
+
+  if (matchTable != NULL && tableLen == len && tableCols == cols)
+    return 0;
+
+  free(matchTable);
+  matchTable = NULL;
+  tableLen = tableCols = 0;
+
+  if (n < 0 || n > MAX_TABLE_CODES)
+    return -1;
+
+  cells = (size_t)n * (n + 1) / 2;
+  matchTable = (unsigned char *)calloc((len <= TABLE_NIBBLE_LEN) ? (cells + 1) / 2 : cells, 1);
+  if (matchTable == NULL)
+    return -1;
+
+  for (int i = 0; i < n; i++)
+  {
+    indexToSeq(seq1, i, len, cols);
+    for (int j = 0; j <= i; j++)
+    {
+      size_t cell = tableCell(i, j);
+      int fb, c;
+
+      indexToSeq(seq2, j, len, cols);
+      struct matches res = scoreMatches(seq1, seq2, len, cols);
+      fb = PACK_MATCHES(res, len);
+      if (len > TABLE_NIBBLE_LEN)
+      {
+        matchTable[cell] = fb;
+        continue;
+      }
+      // the 4-bit codes are handed out in the order the feedbacks first turn up
+      for (c = 0; c < codes && tableFb[c] != fb; c++)
+        ;
+      if (c == codes)
+        tableFb[codes++] = fb;
+      matchTable[cell / 2] |= c << (cell % 2 * 4);
+    }
+  }
+
+  tableLen = len;
+  tableCols = cols;
+
+  return 0;
+}
+
+int matchIndex(int idx1, int idx2)
+{
+  return tableGet(tableCell(idx1, idx2), tableLen);
+}
+
+struct matches lookupMatches(const int *seq1, const int *seq2, int len, int cols)
+{
+  if (matchTable != NULL && tableLen == len && tableCols == cols)
+  {
+    int i1 = seqToIndex(seq1, len, cols);
+    int i2 = seqToIndex(seq2, len, cols);
+
+    if (i1 >= 0 && i2 >= 0)
+    {
+      int fb = tableGet(tableCell(i1, i2), len);
+      struct matches res = {UNPACK_EXACT(fb, len), UNPACK_APPROX(fb, len)};
+      return res;
+    }
+  }
+
+  return scoreMatches(seq1, seq2, len, cols);
+}
+
+/* ======================================================= */
+/* SECTION: kernels specialised per configuration          */
+/* ------------------------------------------------------- */
+
+/* Same result as scoreMatches(), but the approximate matches are counted by    */
+/* taking colours of the non-exact guess pegs out of the secret's histogram, so */
+/* both loops run over the length only, independent of the number of colours.  */
+/* With a constant @len@ the compiler unrolls both loops completely.           */
+static inline __attribute__((always_inline)) struct matches scoreFixed(const int *seq1, const int *seq2, const int len)
+{
+  unsigned char hist[MAX_COLS + 1] = {0};
+  struct matches res = {0, 0};
+
+  for (int i = 0; i < len; i++)
+  {
+    int eq = (seq1[i] == seq2[i]);
+    res.exact += eq;
+    hist[seq1[i]] += !eq;
+  }
+
+  for (int i = 0; i < len; i++)
+  {
+    int hit = (seq1[i] != seq2[i]) & (hist[seq2[i]] != 0);
+    hist[seq2[i]] -= hit;
+    res.approx += hit;
+  }
+
+  return res;
+}
+
+/* table lookup with the index computation unrolled for a constant @len@; */
+/* sequences with an entry outside 1..tableCols are scored directly        */
+static inline __attribute__((always_inline)) struct matches tableFixed(const int *seq1, const int *seq2, const int len)
+{
+  unsigned int i1 = 0, i2 = 0, bad = 0;
+
+  for (int i = 0; i < len; i++)
+  {
+    unsigned int c1 = seq1[i] - 1, c2 = seq2[i] - 1;
+    bad |= (c1 >= (unsigned int)tableCols) | (c2 >= (unsigned int)tableCols);
+    i1 = i1 * tableCols + c1;
+    i2 = i2 * tableCols + c2;
+  }
+
+  if (bad)
+    return scoreFixed(seq1, seq2, len);
+
+  int fb = tableGet(tableCell(i1, i2), len);
+  struct matches res = {UNPACK_EXACT(fb, len), UNPACK_APPROX(fb, len)};
+  return res;
+}
+
+#define FIXED_KERNELS(L)                                                   \
+  static struct matches scoreLen##L(const int *seq1, const int *seq2)      \
+  {                                                                        \
+    return scoreFixed(seq1, seq2, L);                                      \
+  }                                                                        \
+  static struct matches tableLen##L(const int *seq1, const int *seq2)      \
+  {                                                                        \
+    return tableFixed(seq1, seq2, L);                                      \
+  }
+
+FIXED_KERNELS(1)
+FIXED_KERNELS(2)
+FIXED_KERNELS(3)
+FIXED_KERNELS(4)
+FIXED_KERNELS(5)
+FIXED_KERNELS(6)
+FIXED_KERNELS(7)
+FIXED_KERNELS(8)
+
+static const score_fn scoreKernels[MAX_SEQL + 1] = {
+    NULL, scoreLen1, scoreLen2, scoreLen3, scoreLen4, scoreLen5, scoreLen6, scoreLen7, scoreLen8};
+static const score_fn tableKernels[MAX_SEQL + 1] = {
+    NULL, tableLen1, tableLen2, tableLen3, tableLen4, tableLen5, tableLen6, tableLen7, tableLen8};
+
+score_fn unrolledKernel(int len)
+{
+  if (len < 1 || len > MAX_SEQL)
+    return NULL;
+
+  return scoreKernels[len];
+}
+
+score_fn tableKernel(int len, int cols)
+{
+  if (len < 1 || len > MAX_SEQL || initMatchTable(len, cols) != 0)
+    return NULL;
+
+  return tableKernels[len];
+}
+
+score_fn selectKernel(int len, int cols)
+{
+  if (len < 1 || len > MAX_SEQL || cols < 1 || cols > MAX_COLS)
+    return NULL;
+
+  if (initMatchTable(len, cols) == 0)
+    return tableKernels[len];
+
+  return scoreKernels[len];
+}
+
+/* ======================================================= */
+/* SECTION: ARM Assembler kernel                           */
+/* ------------------------------------------------------- */
+
+#if defined(__arm__)
+/* The original inline-Assembler version, previously in master-mind.c and testm.c. */
+/* It only remembers the last colour it counted as approximate match (R4), so it   */
+/* is not correct for every input; it is kept so the testers can compare against   */
+/* it. The result is written into @data@, which is also returned.                  */
+/* noinline: the asm uses global labels, which must appear only once. It uses      */
+/* R0..R10 and reads the sequences, hence the clobbers; as that leaves few         */
+/* registers, the two pointers are loaded from memory operands.                    */
+__attribute__((noinline)) int *countMatches_asm(int *seq1, int *seq2, int seqlen, int *data)
+{
+  int res_exact = 0;
+  int res_approx = 0;
+
+  asm(
+      "start:\n"
+      "\tMOV R0, #0\n" // exact
+      "\tMOV R3, #0\n" // approx
+      "\tLDR R1, %[seq1]\n"
+      "\tLDR R2, %[seq2]\n"
+      "\tMOV R4, #0\n" // approx indicator
+      "\tMOV R5, #0\n" // length 1
+      "\tMOV R7, #0\n" // index 1
+      "\tMOV R6, #0\n" // length 2
+      "\tMOV R8, #0\n" // index 2
+      "\tB main_loop\n"
+
+      "main_loop:\n"
+      "\tCMP R5, %[seqlen]\n"
+      "\tBEQ exit_routine\n"
+
+      "\tLDR R9, [R1, R7]\n"
+      "\tLDR R10, [R2, R7]\n"
+
+      "\tCMP R9, R10\n"
+      "\tBEQ add_exact\n"
+
+      "\tMOV R6, #0\n"
+      "\tMOV R8, #0\n"
+      "\tB approx_loop\n"
+      "\tB loop_increment1\n"
+
+      "loop_increment1:\n"
+      "\tADD R5, R5, #1\n"
+      "\tADD R7, R7, #4\n"
+      "\tB main_loop\n"
+
+      "add_exact:\n"
+      "\tADD R0, R0, #1\n"
+      "\tCMP R10, R4\n"
+      "\tBEQ check_approx_size\n"
+      "\tB loop_increment1\n"
+
+      "check_approx_size:\n"
+      "\tCMP R3, #0\n"
+      "\tBNE decrement_approx\n"
+      "\tB loop_increment1\n"
+
+      "decrement_approx:\n"
+      "\tSUB R3, R3, #1\n"
+      "\tB loop_increment1\n"
+
+      "approx_loop:\n"
+      "\tCMP R6, %[seqlen]\n"
+      "\tBEQ loop_increment1\n"
+
+      "\tLDR R10, [R2, R8]\n"
+
+      "\tCMP R9, R10\n"
+      "\tBEQ index_check\n"
+      "\tB loop_increment2\n"
+
+      "loop_increment2:\n"
+      "\tADD R6, R6, #1\n"
+      "\tADD R8, R8, #4\n"
+      "\tB approx_loop\n"
+
+      "index_check:\n"
+      "\tCMP R5, R6\n"
+      "\tBNE approx_check\n"
+      "\tB loop_increment2\n"
+
+      "approx_check:\n"
+      "\tCMP R10, R4\n"
+      "\tBNE add_approx\n"
+      "\tB loop_increment2\n"
+
+      "add_approx:\n"
+      "\tMOV R4, R10\n"
+      "\tADD R3, R3, #1\n"
+      "\tMOV R6, #2\n"
+      "\tB loop_increment2\n"
+
+      "exit_routine:\n"
+      "\tMOV %[result_exact], R0\n"
+      "\tMOV %[result_approx], R3\n"
+
+      : [result_exact] "=r"(res_exact), [result_approx] "=r"(res_approx)
+      : [seq1] "m"(seq1), [seq2] "m"(seq2), [seqlen] "r"(seqlen)
+      : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+
+  data[0] = res_exact;
+  data[1] = res_approx;
+
+  return data;
+}
+#endif
@@ -0,0 +1,163 @@
+/* ***************************************************************************** */
+/* Scoring kernels for the MasterMind matching function.                         */
+/* Shared by master-mind.c and the testers; no allocation on any scoring path.   */
+/* ***************************************************************************** */
+
+#ifndef MM_SCORE_H
+#define MM_SCORE_H
+
+// upper bounds for the number of colours and the length of a sequence
+// colours are entered as single digits, so 9 is the most we can represent
+#define MAX_COLS 9
+#define MAX_SEQL 8
+
+/* exact and approximate matches of a guess against a secret */
+struct matches
+{
+  int exact;
+  int approx;
+};
+
+/* counts exact and approximate matches of @seq2@ against @seq1@, both of length @len@ */
+/* entries must be colours in the range 1..@cols@; the result is returned by value     */
+/* this is the contract of every kernel below: none of them checks its input, and they */
+/* disagree on entries outside the range, so whatever reads sequences from the user    */
+/* must reject them with validSeq() first                                              */
+struct matches scoreMatches(const int *seq1, const int *seq2, int len, int cols);
+
+/* non-zero if all @len@ entries of @seq@ are colours in the range 1..@cols@ */
+int validSeq(const int *seq, int len, int cols);
+
+/* ------------------------------------------------------- */
+/* feedback lookup table over the whole code space          */
+
+// largest code space for which the table is built: 6 colours, length 4
+// (1296 codes, one triangle of 4-bit cells: 410 KB); larger spaces use the
+// kernel directly
+#define MAX_TABLE_CODES 1296
+
+/* pack/unpack a result into one byte, as exact*(len+1)+approx */
+#define PACK_MATCHES(m, len) ((m).exact * ((len) + 1) + (m).approx)
+#define UNPACK_EXACT(fb, len) ((fb) / ((len) + 1))
+#define UNPACK_APPROX(fb, len) ((fb) % ((len) + 1))
+
+/* number of codes with @len@ pegs of @cols@ colours, or -1 if that overflows an int */
+int codeSpace(int len, int cols);
+
+/* turn a sequence of colours 1..@cols@ into its index in the code space, or -1 */
+/* if an entry is out of range; the first peg is the most significant digit     */
+int seqToIndex(const int *seq, int len, int cols);
+
+/* the inverse of seqToIndex(): put the colours of code @idx@ into @seq@ */
+void indexToSeq(int *seq, int idx, int len, int cols);
+
+/* build the (secret index, guess index) -> packed feedback table;       */
+/* returns 0 on success, -1 if the code space is too large for a table */
+int initMatchTable(int len, int cols);
+
+/* packed feedback for two code indices; only valid after initMatchTable() */
+int matchIndex(int idx1, int idx2);
+
+/* like scoreMatches(), but a single table load if a table for @len@/@cols@ exists */
+struct matches lookupMatches(const int *seq1, const int *seq2, int len, int cols);
+
+/* ------------------------------------------------------- */
+/* kernels specialised to one configuration                 */
+
+/* a scoring kernel for one fixed (colours, length) pair, selected at runtime */
+typedef struct matches (*score_fn)(const int *seq1, const int *seq2);
+
+/* select the kernel for @len@ pegs of @cols@ colours: a table lookup if the code */
+/* space fits into the table (which is built here), otherwise a kernel that is    */
+/* fully unrolled for @len@; returns NULL if @len@ or @cols@ is out of range      */
+score_fn selectKernel(int len, int cols);
+
+/* the individual kernels behind selectKernel(); tableKernel() builds the table */
+/* and returns NULL if the code space is too large for one                      */
+score_fn unrolledKernel(int len);
+score_fn tableKernel(int len, int cols);
+
+/* ------------------------------------------------------- */
+/* batch scoring of one guess against many codes (mm-batch.c) */
+
+/* a set of codes in structure-of-arrays layout: peg @p@ of code @k@ is  */
+/* pegs[p * stride + k], one byte per peg; stride is a multiple of 32    */
+struct codeSet
+{
+  unsigned char *pegs;
+  int n;
+  int stride;
+  int len;
+  int cols;
+};
+
+/* a batch kernel: writes the packed feedback (see PACK_MATCHES) of @guess@ */
+/* against every code of @set@ into out[0..set->n-1]                        */
+typedef void (*batch_fn)(const int *guess, const struct codeSet *set, unsigned char *out);
+
+/* allocate a set for @n@ codes of length @len@; all pegs start as 0 */
+struct codeSet *newCodeSet(int n, int len, int cols);
+void freeCodeSet(struct codeSet *set);
+
+/* store @seq@ as code number @k@ of @set@ */
+void setCode(struct codeSet *set, int k, const int *seq);
+
+/* a set holding the whole code space, code @k@ being the one with index @k@ */
+struct codeSet *codeSpaceSet(int len, int cols);
+
+/* the individual kernels; the AVX2 one may only be called if the CPU supports it */
+void countMatchesBatch_scalar(const int *guess, const struct codeSet *set, unsigned char *out);
+#if defined(__x86_64__)
+void countMatchesBatch_sse2(const int *guess, const struct codeSet *set, unsigned char *out);
+void countMatchesBatch_avx2(const int *guess, const struct codeSet *set, unsigned char *out);
+#endif
+#if defined(__ARM_NEON)
+void countMatchesBatch_neon(const int *guess, const struct codeSet *set, unsigned char *out);
+#endif
+
+/* the best batch kernel for this CPU */
+batch_fn selectBatchKernel(void);
+
+/* score @guess@ against every code of @set@, using the bound batch kernel; */
+/* this is selectBatchKernel() unless another one was set with setBatchKernel() */
+void countMatchesBatch(const int *guess, const struct codeSet *set, unsigned char *out);
+void setBatchKernel(batch_fn kernel);
+
+/* ------------------------------------------------------- */
+/* kernel registry (mm-registry.c)                          */
+
+/* one registered kernel, with the outcome of its self-check and benchmark */
+struct kernelInfo
+{
+  const char *name;
+  score_fn fn;
+  int available; // supported by this build, CPU and configuration
+  int ok;        // agrees with scoreMatches() on the self-check sample
+  double ns;     // measured ns per scored pair
+};
+
+struct batchKernelInfo
+{
+  const char *name;
+  batch_fn fn;
+  int available;
+  int ok;
+  double ns; // measured ns per scored code
+};
+
+/* check and benchmark every registered kernel for @len@ pegs of @cols@ colours,  */
+/* bind the fastest correct batch kernel, and return the fastest correct kernel; */
+/* the environment variables MM_KERNEL and MM_BATCH_KERNEL override the choice  */
+/* by name, and print the measurements if set                                   */
+score_fn bindKernel(int len, int cols);
+
+/* the registered kernels, as measured by the last call of bindKernel() */
+const struct kernelInfo *scoreKernelList(int *n);
+const struct batchKernelInfo *batchKernelList(int *n);
+
+#if defined(__arm__)
+/* the original inline-Assembler matching fct; kept for comparison in the testers */
+int *countMatches_asm(int *seq1, int *seq2, int seqlen, int *data);
+#endif
+
+#endif
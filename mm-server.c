@@ -0,0 +1,371 @@
+/* ***************************************************************************** */
+/* Headless game server on a Unix domain socket, see option -U.                  */
+/*                                                                               */
+/* Every connection is a session with a text protocol, one command per line:     */
+/*   new [<secret>]   start a game, with a random secret unless one is given     */
+/*                    -> "ok <length> <colours>"                                 */
+/*   guess <digits>   -> "result <exact> <approximate>", or "win <rounds>"       */
+/*   quit             end the session                                            */
+/* anything else gets "error <reason>". Guesses are scored by countMatches(),    */
+/* as in the game. One epoll loop serves all sessions; their state lives in a    */
+/* small struct from a pool that grows in chunks and is never returned, so       */
+/* tens of thousands of sessions cost a few MB and no allocation per connect.    */
+/* Out of descriptors, a spare one is given up to take the pending connection    */
+/* and close it at once, so the listening socket doesn't stay readable and spin  */
+/* the loop. The server runs until SIGINT or SIGTERM, and then prints its        */
+/* counters.                                                                     */
+/* ***************************************************************************** */
+
+#define _GNU_SOURCE // accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "mm-score.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+// longest command line, newline included
+#define SESSION_LINE 48
+// sessions allocated at once when the pool runs dry
+#define POOL_CHUNK 1024
+// events taken from epoll at once
+#define MAX_EVENTS 256
+
+int failure(int fatal, const char *message, ...);
+
+struct session
+{
+  int fd;
+  uint8_t secret[MAX_SEQL];
+  uint8_t rounds;  // guesses in the current game
+  uint8_t playing; // a game is running
+  uint8_t len;     // bytes of a partial line in buf
+  char buf[SESSION_LINE];
+  struct session *next; // in the free list
+};
+
+/* counters, printed when the server stops */
+struct serverStats
+{
+  unsigned long connects, refused, games, guesses, wins, errors;
+  int open, maxOpen;
+};
+
+static struct session *freeList = NULL;
+static struct serverStats stats;
+static volatile sig_atomic_t stopping = 0;
+// kept open to be closed when accept4 runs out of descriptors, see onAccept
+static int spareFd = -1;
+
+static int seqLen, numColors;
+static const int *fixedSecret;
+static int *(*score)(int *, int *);
+
+/* ======================================================= */
+/* SECTION: session pool                                   */
+/* ------------------------------------------------------- */
+
+static struct session *sessionAlloc(void)
+{
+  struct session *s;
+
+  if (freeList == NULL)
+  {
+    struct session *chunk = malloc(POOL_CHUNK * sizeof(struct session));
+    if (chunk == NULL)
+      return NULL;
+    for (int i = 0; i < POOL_CHUNK; i++)
+    {
+      chunk[i].next = freeList;
+      freeList = &chunk[i];
+    }
+  }
+
+  s = freeList;
+  freeList = s->next;
+  return s;
+}
+
+static void sessionFree(struct session *s)
+{
+  s->next = freeList;
+  freeList = s;
+}
+
+/* ======================================================= */
+/* SECTION: protocol                                       */
+/* ------------------------------------------------------- */
+
+/* send @msg@; replies are a few bytes, so a socket that can't take them at once */
+/* belongs to a client that doesn't read, and the session is dropped             */
+static int reply(struct session *s, const char *msg)
+{
+  size_t n = strlen(msg);
+  return send(s->fd, msg, n, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t)n ? 0 : -1;
+}
+
+/* parse @len@ digits 1..numColors from @str@ into @seq@; 0 if malformed */
+static int parseSeq(int *seq, const char *str)
+{
+  for (int i = 0; i < seqLen; i++)
+  {
+    if (str[i] < '1' || str[i] > '0' + numColors)
+      return 0;
+    seq[i] = str[i] - '0';
+  }
+  return str[seqLen] == '\0';
+}
+
+/* run the command @line@ of @s@; returns -1 if the session ends */
+static int command(struct session *s, char *line)
+{
+  char msg[64];
+  int seq[MAX_SEQL], secret[MAX_SEQL];
+
+  if (strcmp(line, "quit") == 0)
+    return -1;
+
+  if (strcmp(line, "new") == 0 || strncmp(line, "new ", 4) == 0)
+  {
+    if (line[3] == ' ' && !parseSeq(seq, line + 4))
+    {
+      stats.errors++;
+      return reply(s, "error bad secret\n");
+    }
+    for (int i = 0; i < seqLen; i++)
+    {
+      if (line[3] == ' ')
+        s->secret[i] = seq[i];
+      else
+        s->secret[i] = (fixedSecret != NULL) ? fixedSecret[i] : (rand() % numColors) + 1;
+    }
+    s->rounds = 0;
+    s->playing = 1;
+    stats.games++;
+    snprintf(msg, sizeof(msg), "ok %d %d\n", seqLen, numColors);
+    return reply(s, msg);
+  }
+
+  if (strncmp(line, "guess ", 6) == 0)
+  {
+    int *res;
+
+    if (!s->playing)
+    {
+      stats.errors++;
+      return reply(s, "error no game\n");
+    }
+    if (!parseSeq(seq, line + 6))
+    {
+      stats.errors++;
+      return reply(s, "error bad guess\n");
+    }
+    for (int i = 0; i < seqLen; i++)
+      secret[i] = s->secret[i];
+    res = score(secret, seq);
+    stats.guesses++;
+    if (s->rounds < UINT8_MAX)
+      s->rounds++;
+    if (res[0] == seqLen)
+    {
+      s->playing = 0;
+      stats.wins++;
+      snprintf(msg, sizeof(msg), "win %d\n", s->rounds);
+    }
+    else
+      snprintf(msg, sizeof(msg), "result %d %d\n", res[0], res[1]);
+    return reply(s, msg);
+  }
+
+  stats.errors++;
+  return reply(s, "error unknown command\n");
+}
+
+/* read what @s@ sent, and run its complete lines; returns -1 if the session ends */
+static int onReadable(struct session *s)
+{
+  char in[4096];
+  ssize_t n;
+
+  while ((n = read(s->fd, in, sizeof(in))) > 0)
+  {
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (in[i] == '\r')
+        continue;
+      if (in[i] != '\n')
+      {
+        if (s->len == SESSION_LINE - 1)
+        {
+          stats.errors++;
+          reply(s, "error line too long\n");
+          return -1;
+        }
+        s->buf[s->len++] = in[i];
+        continue;
+      }
+      s->buf[s->len] = '\0';
+      s->len = 0;
+      if (command(s, s->buf) != 0)
+        return -1;
+    }
+  }
+
+  return (n == 0 || errno != EAGAIN) ? -1 : 0;
+}
+
+/* ======================================================= */
+/* SECTION: event loop                                     */
+/* ------------------------------------------------------- */
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  stopping = 1;
+}
+
+/* take all pending connections from the listening socket @lfd@ */
+static void onAccept(int epfd, int lfd)
+{
+  struct epoll_event ev;
+  struct session *s;
+  int fd;
+
+  for (;;)
+  {
+    if ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0)
+    {
+      if ((errno != EMFILE && errno != ENFILE) || spareFd < 0)
+        return;
+      // the connection stays pending, and the level-triggered socket readable: refuse it
+      close(spareFd);
+      if ((fd = accept(lfd, NULL, NULL)) >= 0)
+      {
+        close(fd);
+        stats.refused++;
+      }
+      spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        return;
+      continue;
+    }
+    if ((s = sessionAlloc()) == NULL)
+    {
+      close(fd);
+      continue;
+    }
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = s;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      close(fd);
+      sessionFree(s);
+      continue;
+    }
+    stats.connects++;
+    if (++stats.open > stats.maxOpen)
+      stats.maxOpen = stats.open;
+  }
+}
+
+int runServer(const char *path, int *(*countMatches)(int *, int *), int len, int cols, const int *secret)
+{
+  struct epoll_event evs[MAX_EVENTS], ev;
+  struct sockaddr_un addr;
+  struct sigaction sa;
+  struct rlimit rl;
+  int lfd, epfd, n;
+
+  score = countMatches;
+  seqLen = len;
+  numColors = cols;
+  fixedSecret = secret;
+
+  // one descriptor per session: allow as many as the hard limit does
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+  {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    failure(TRUE, "server: socket path %s too long\n", path);
+  strcpy(addr.sun_path, path);
+  unlink(path);
+
+  if ((lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 ||
+      bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, SOMAXCONN) != 0)
+    failure(TRUE, "server: unable to listen on %s: %s\n", path, strerror(errno));
+  if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    failure(TRUE, "server: epoll_create1 failed: %s\n", strerror(errno));
+  if ((spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC)) < 0)
+    failure(TRUE, "server: unable to open /dev/null: %s\n", strerror(errno));
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL; // the listening socket
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) != 0)
+    failure(TRUE, "server: epoll_ctl failed: %s\n", strerror(errno));
+
+  // no SA_RESTART: the signal ends epoll_wait with EINTR
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  fprintf(stderr, "server: listening on %s\n", path);
+  while (!stopping)
+  {
+    if ((n = epoll_wait(epfd, evs, MAX_EVENTS, -1)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      failure(TRUE, "server: epoll_wait failed: %s\n", strerror(errno));
+    }
+    for (int i = 0; i < n; i++)
+    {
+      struct session *s = evs[i].data.ptr;
+
+      if (s == NULL)
+      {
+        onAccept(epfd, lfd);
+        continue;
+      }
+      if (onReadable(s) != 0 || (evs[i].events & (EPOLLHUP | EPOLLERR)))
+      {
+        close(s->fd); // also takes it out of the epoll set
+        sessionFree(s);
+        stats.open--;
+      }
+    }
+  }
+
+  close(lfd);
+  if (spareFd >= 0)
+    close(spareFd);
+  unlink(path);
+  fprintf(stdout, "server: %lu connections (%d at most at once, %lu refused), %lu games, %lu guesses, %lu wins, %lu errors\n",
+          stats.connects, stats.maxOpen, stats.refused, stats.games, stats.guesses, stats.wins, stats.errors);
+
+  return 0;
+}
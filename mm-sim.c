@@ -0,0 +1,290 @@
+/* ***************************************************************************** */
+/* Simulated hardware for headless runs of the game loop, see option -S.         */
+/*                                                                               */
+/* The GPIO registers come from the "sim" backend of mm-gpio.c, so pinMode,      */
+/* writeLED and readButton run unchanged. A player enters the guesses of a       */
+/* script by setting the button's bit in GPLEV0, one press per period, held for  */
+/* half of it. The sampler of mm-input.c turns the bit into press and release    */
+/* events, and the decoder of mm-decode.c ends the digit once the button has     */
+/* been idle for its gap. Presses are events of the clock in mm-clock.c, so the  */
+/* player runs in virtual time as well (option -V).                              */
+/*                                                                               */
+/* Several players may play the same script, each on its own button, for the     */
+/* stations of mm-station.c; the trace follows the first one.                    */
+/*                                                                               */
+/* Script format: one guess per line as a digit string, e.g. "123"; each digit   */
+/* (1..9) is entered as that many presses. Lines starting with '#' are ignored.  */
+/*                                                                               */
+/* The game loop records the start of every phase with tracePhase(); simReport() */
+/* turns these timestamps into latency distributions.                            */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "mm-clock.h"
+#include "mm-gpio.h"
+#include "mm-sim.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+// capacity of the trace, and largest number of rounds that are reported
+#define SIM_EVENTS 4096
+#define SIM_ROUNDS 64
+#define SIM_GUESSES 64
+#define SIM_PLAYERS 8
+
+int failure(int fatal, const char *message, ...);
+
+int simEnabled = 0;
+
+static uint32_t *simRegs;
+static int simPeriodMs;
+static char *guesses[SIM_GUESSES];
+static int nguesses = 0;
+
+/* a player works through the guesses of the script on its button */
+struct player
+{
+  int button;
+  int nextGuess;
+  const char *nextDigit;
+};
+static struct player players[SIM_PLAYERS];
+static int nplayers = 0;
+
+static const char *phaseNames[PH_COUNT] = {
+    "round-signal", "wait-press", "input-window", "echo", "input-done", "score", "feedback", "done", "end"};
+
+struct event
+{
+  enum phase ph;
+  int round;
+  uint64_t t; // micro-seconds
+};
+
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+static struct event events[SIM_EVENTS];
+static int nevents = 0, curRound = 0;
+static uint64_t lastRelease[SIM_ROUNDS];
+
+
+/* ======================================================= */
+/* SECTION: trace                                          */
+/* ------------------------------------------------------- */
+
+void tracePhase(enum phase ph)
+{
+  if (!simEnabled)
+    return;
+
+  pthread_mutex_lock(&traceLock);
+  if (ph == PH_ROUND)
+    curRound++;
+  if (nevents < SIM_EVENTS)
+  {
+    events[nevents].ph = ph;
+    events[nevents].round = curRound;
+    events[nevents].t = clockNow();
+    nevents++;
+  }
+  pthread_mutex_unlock(&traceLock);
+
+  if (ph == PH_WAIT && !simPlayDigit(players[0].button))
+  {
+    fprintf(stderr, "sim: the script has no more guesses\n");
+    simReport();
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* ======================================================= */
+/* SECTION: player                                         */
+/* ------------------------------------------------------- */
+
+static void setButton(int button, int value)
+{
+  if (value)
+    __atomic_or_fetch(&simRegs[GPLEV0], 1u << (button & 31), __ATOMIC_SEQ_CST);
+  else
+    __atomic_and_fetch(&simRegs[GPLEV0], ~(1u << (button & 31)), __ATOMIC_SEQ_CST);
+}
+
+static void press(void *arg)
+{
+  struct player *p = arg;
+  setButton(p->button, 1);
+}
+
+static void release(void *arg)
+{
+  struct player *p = arg;
+  setButton(p->button, 0);
+  if (p != &players[0])
+    return;
+  pthread_mutex_lock(&traceLock);
+  if (curRound < SIM_ROUNDS)
+    lastRelease[curRound] = clockNow();
+  pthread_mutex_unlock(&traceLock);
+}
+
+/* the game waits for the press events of a digit: schedule the presses of the next digit */
+int simPlayDigit(int button)
+{
+  struct player *p = NULL;
+
+  for (int i = 0; i < nplayers; i++)
+    if (players[i].button == button)
+      p = &players[i];
+  if (p == NULL)
+    return 0;
+
+  if (*p->nextDigit == '\0')
+  {
+    if (p->nextGuess == nguesses)
+      return 0;
+    p->nextDigit = guesses[p->nextGuess++];
+  }
+
+  /* every press is held for half a period and followed by half a period up, both far   */
+  /* longer than the sampler debounces; the schedule is fixed from the first press on, so */
+  /* late timers on either side don't add up, and the decoder's idle gap only starts      */
+  /* after the last release                                                               */
+  int presses = *p->nextDigit++ - '0';
+  uint64_t t0 = clockNow(), period = (uint64_t)simPeriodMs * 1000, quarter = period / 4;
+
+  setButton(p->button, 1); // the first press goes down at once, as the game starts waiting for it
+  clockAt(t0 + quarter, release, p);
+  for (int k = 1; k < presses; k++)
+  {
+    clockAt(t0 + k * period - quarter, press, p);
+    clockAt(t0 + k * period + quarter, release, p);
+  }
+
+  return 1;
+}
+
+void simPlay(const char *script, uint32_t *regs, int button, int pressMs)
+{
+  FILE *f;
+  char buf[256];
+
+  if (nplayers == SIM_PLAYERS)
+    failure(TRUE, "sim: more than %d players\n", SIM_PLAYERS);
+  players[nplayers].button = button;
+  players[nplayers].nextGuess = 0;
+  players[nplayers].nextDigit = "";
+  nplayers++;
+  if (simEnabled)
+    return; // the script is loaded
+
+  if ((f = fopen(script, "r")) == NULL)
+    failure(TRUE, "sim: unable to open %s: %s\n", script, strerror(errno));
+  while (fgets(buf, sizeof(buf), f) != NULL && nguesses < SIM_GUESSES)
+  {
+    char *tok = buf + strspn(buf, " \t");
+    size_t n = strspn(tok, "123456789");
+    if (*tok == '#' || n == 0)
+      continue;
+    tok[n] = '\0';
+    guesses[nguesses++] = strdup(tok);
+  }
+  fclose(f);
+
+  simRegs = regs;
+  simPeriodMs = pressMs;
+  simEnabled = 1;
+}
+
+/* ======================================================= */
+/* SECTION: report                                         */
+/* ------------------------------------------------------- */
+
+static int cmpU64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/* print count, min, median, p99, max and mean of @n@ durations in micro-seconds, in ms */
+static void showDist(const char *name, uint64_t *d, int n)
+{
+  uint64_t sum = 0;
+
+  if (n == 0)
+  {
+    fprintf(stdout, "%-20s %5d\n", name, 0);
+    return;
+  }
+  qsort(d, n, sizeof(uint64_t), cmpU64);
+  for (int i = 0; i < n; i++)
+    sum += d[i];
+  fprintf(stdout, "%-20s %5d %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, n, d[0] / 1e3, d[n / 2] / 1e3,
+          d[(int)(n * 0.99)] / 1e3, d[n - 1] / 1e3, sum / 1e3 / n);
+}
+
+void simReport(void)
+{
+  static uint64_t d[SIM_EVENTS];
+  int n;
+
+  pthread_mutex_lock(&traceLock);
+  fprintf(stdout, "\n%-20s %5s %10s %10s %10s %10s %10s\n", "latency (ms)", "n", "min", "p50", "p99", "max", "mean");
+
+  /* a phase lasts until the next one starts */
+  for (int ph = 0; ph < PH_END; ph++)
+  {
+    n = 0;
+    for (int i = 0; i + 1 < nevents; i++)
+      if (events[i].ph == (enum phase)ph)
+        d[n++] = events[i + 1].t - events[i].t;
+    showDist(phaseNames[ph], d, n);
+  }
+
+  /* from the release of the last button press of a round to the start and end of its feedback */
+  n = 0;
+  for (int i = 0; i < nevents; i++)
+    if (events[i].ph == PH_FEEDBACK && events[i].round < SIM_ROUNDS && lastRelease[events[i].round] != 0)
+      d[n++] = events[i].t - lastRelease[events[i].round];
+  showDist("press-to-feedback", d, n);
+  /* from the end of the last digit, when the guess is complete, to the start of its feedback; */
+  /* the part above that the idle gap of the digit decoder doesn't account for                 */
+  n = 0;
+  for (int i = 0, lastEcho = -1; i < nevents; i++)
+  {
+    if (events[i].ph == PH_ECHO)
+      lastEcho = i;
+    else if (events[i].ph == PH_FEEDBACK && lastEcho >= 0 && events[lastEcho].round == events[i].round)
+      d[n++] = events[i].t - events[lastEcho].t;
+  }
+  showDist("guess-to-feedback", d, n);
+  n = 0;
+  for (int i = 0; i + 1 < nevents; i++)
+    if (events[i].ph == PH_FEEDBACK && events[i].round < SIM_ROUNDS && lastRelease[events[i].round] != 0)
+      d[n++] = events[i + 1].t - lastRelease[events[i].round];
+  showDist("press-to-round-end", d, n);
+
+  /* whole rounds, and the whole game */
+  n = 0;
+  for (int i = 0, start = -1; i < nevents; i++)
+  {
+    if (events[i].ph != PH_ROUND && events[i].ph != PH_END)
+      continue;
+    if (start >= 0)
+      d[n++] = events[i].t - events[start].t;
+    start = i;
+  }
+  showDist("round", d, n);
+  n = 0;
+  if (nevents > 0 && events[nevents - 1].ph == PH_END)
+    d[n++] = events[nevents - 1].t - events[0].t;
+  showDist("game", d, n);
+  pthread_mutex_unlock(&traceLock);
+}
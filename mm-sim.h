@@ -0,0 +1,46 @@
+/* ***************************************************************************** */
+/* Simulated hardware for headless runs of the game loop (option -S), and the    */
+/* per-phase trace used to report its latencies.                                 */
+/* ***************************************************************************** */
+
+#ifndef MM_SIM_H
+#define MM_SIM_H
+
+#include <stdint.h>
+
+/* phases of a round, recorded by the game loop via tracePhase() */
+enum phase
+{
+  PH_ROUND,      // round starts; red LED signals it
+  PH_WAIT,       // waiting for the first press of a digit
+  PH_INPUT,      // first press seen; input window for the digit running
+  PH_ECHO,       // input window closed; digit is echoed on the LEDs
+  PH_INPUT_DONE, // all digits entered; red LED signals end of input
+  PH_SCORE,      // scoring the guess
+  PH_FEEDBACK,   // the LEDs start signalling exact/approximate matches; rounds that
+                 // are won, or lost at the end, go from scoring straight to done
+  PH_DONE,       // round finished
+  PH_END,        // game finished (success or out of rounds)
+  PH_COUNT
+};
+
+/* non-zero while the game runs against the simulated hardware */
+extern int simEnabled;
+
+/* start a player that enters the guesses in @script@ on @button@, by setting    */
+/* its bit in GPLEV0 of the simulated registers @regs@, one press every @pressMs@ */
+/* milli-seconds of the current clock; further calls add players on other        */
+/* buttons, which play the script of the first call                               */
+void simPlay(const char *script, uint32_t *regs, int button, int pressMs);
+
+/* schedule the presses of the next digit of the player on @button@; returns 0 if */
+/* it has no more guesses (tracePhase(PH_WAIT) does this for the first player)    */
+int simPlayDigit(int button);
+
+/* record the start of phase @ph@ (no-op unless simEnabled) */
+void tracePhase(enum phase ph);
+
+/* print per-phase, per-round and per-game latency distributions */
+void simReport(void);
+
+#endif
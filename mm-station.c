@@ -0,0 +1,239 @@
+/* ***************************************************************************** */
+/* Game stations on one event loop; see mm-station.h.                            */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mm-clock.h"
+#include "mm-input.h"
+#include "mm-loop.h"
+#include "mm-sim.h"
+#include "mm-station.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+#define INPUT 0
+#define OUTPUT 1
+
+int failure(int fatal, const char *message, ...);
+void pinMode(uint32_t *gpio, int pin, int mode);
+void writePins(uint32_t *gpio, uint32_t setMask, uint32_t clearMask);
+void blinkAsync(struct ledSeq *seq, uint32_t *gpio, int led, int c);
+void glowAsync(struct ledSeq *seq, uint32_t *gpio, int green, int red, int exact, int approx);
+
+const int stationPins[MAX_STATIONS][3] = {{13, 5, 19}, {6, 12, 26}, {16, 20, 21}, {17, 18, 4}};
+
+static const struct stationConfig *conf;
+static struct station stations[MAX_STATIONS];
+static int nstations = 0;
+
+static void startDigit(struct station *st);
+
+/* ======================================================= */
+/* SECTION: game of a station                              */
+/* ------------------------------------------------------- */
+
+static void startRound(struct station *st)
+{
+  st->round++;
+  st->digit = 0;
+  blinkAsync(&st->leds, conf->gpio, st->red, 3);
+  fprintf(stdout, "Station %d: round %d\n", st->id + 1, st->round);
+  startDigit(st);
+}
+
+static void startDigit(struct station *st)
+{
+  decodeBegin(&st->dec);
+  st->state = ST_WAIT;
+  st->inputFrom = clockNow();
+  if (simEnabled && !simPlayDigit(st->button))
+  {
+    fprintf(stdout, "Station %d: the script has no more guesses\n", st->id + 1);
+    st->state = ST_DONE;
+    st->endT = clockNow();
+  }
+}
+
+/* all digits of the guess are in, and their echo has played out */
+static void scoreRound(void *arg)
+{
+  struct station *st = arg;
+  struct matches m = conf->score(st->secret, st->guess);
+
+  fprintf(stdout, "Station %d: guess", st->id + 1);
+  for (int i = 0; i < conf->seqlen; i++)
+    fprintf(stdout, " %d", st->guess[i]);
+  fprintf(stdout, ": %d exact, %d approximate\n", m.exact, m.approx);
+
+  if (m.exact == conf->seqlen)
+  {
+    st->found = 1;
+    blinkAsync(&st->leds, conf->gpio, st->green, 3);
+  }
+  else if (conf->blink)
+  {
+    blinkAsync(&st->leds, conf->gpio, st->green, m.exact);
+    blinkAsync(&st->leds, conf->gpio, st->red, 1);
+    blinkAsync(&st->leds, conf->gpio, st->green, m.approx);
+  }
+  else
+    glowAsync(&st->leds, conf->gpio, st->green, st->red, m.exact, m.approx);
+
+  if (st->found || st->round == MAX_ROUNDS)
+  {
+    st->state = ST_DONE;
+    st->endT = clockNow();
+    return;
+  }
+  startRound(st);
+}
+
+static void onDeadline(void *arg);
+
+/* (re-)arm the timer of the station for the deadline of its decoder */
+static void armDeadline(struct station *st)
+{
+  uint64_t deadline = decodeDeadline(&st->dec), now = clockNow();
+
+  loopCancelTimer(st->timer);
+  st->timer = -1;
+  if (deadline == UINT64_MAX)
+    return;
+  if ((st->timer = loopAddTimer(deadline > now ? deadline - now : 0, 0, onDeadline, st)) < 0)
+    failure(TRUE, "station: out of timers\n");
+}
+
+static void onDeadline(void *arg)
+{
+  struct station *st = arg;
+  uint64_t now = clockNow();
+  int n;
+
+  st->timer = -1;
+  if (st->state != ST_INPUT)
+    return;
+  if (!decodeDone(&st->dec, now))
+  {
+    armDeadline(st);
+    return;
+  }
+
+  n = decodeEnd(&st->dec, now);
+  st->guess[st->digit++] = (n > conf->colors) ? conf->colors : n;
+  blinkAsync(&st->leds, conf->gpio, st->red, 1);
+  blinkAsync(&st->leds, conf->gpio, st->green, st->guess[st->digit - 1]);
+
+  if (st->digit < conf->seqlen)
+    startDigit(st);
+  else
+  { // as in the single game, the echo plays out first, so a round queues no more than its own steps
+    st->state = ST_ECHO;
+    ledOnIdle(&st->leds, scoreRound, st);
+  }
+}
+
+static void onButton(struct station *st, const struct inputEvent *ev)
+{
+  if (st->state == ST_DONE || st->state == ST_ECHO)
+    return;
+  if (ev->pressed)
+  {
+    if (ev->t < st->inputFrom)
+      return;
+    decodePress(&st->dec, ev->t);
+    st->state = ST_INPUT;
+  }
+  else if (st->state == ST_INPUT)
+    decodeRelease(&st->dec, ev->t);
+  else
+    return;
+  armDeadline(st);
+}
+
+/* presses and releases of all buttons, from the sampler of mm-input.c */
+static void onInputEvents(void *arg)
+{
+  struct inputEvent ev;
+
+  (void)arg;
+  while (inputPop(&ev))
+    for (int i = 0; i < nstations; i++)
+      if (stations[i].button == ev.pin)
+        onButton(&stations[i], &ev);
+}
+
+/* ======================================================= */
+/* SECTION: interface                                      */
+/* ------------------------------------------------------- */
+
+static int allDone(void)
+{
+  for (int i = 0; i < nstations; i++)
+    if (stations[i].state != ST_DONE)
+      return 0;
+  return 1;
+}
+
+int stationsRun(const struct stationConfig *cfg, int n, const int *secret)
+{
+  uint32_t buttons = 0, leds = 0;
+  int found = 0;
+
+  conf = cfg;
+  nstations = n;
+  for (int i = 0; i < n; i++)
+  {
+    struct station *st = &stations[i];
+
+    memset(st, 0, sizeof(*st));
+    st->id = i;
+    st->green = stationPins[i][0];
+    st->red = stationPins[i][1];
+    st->button = stationPins[i][2];
+    st->dec.station = i;
+    st->timer = -1;
+    for (int j = 0; j < cfg->seqlen; j++)
+      st->secret[j] = (secret != NULL) ? secret[j] : (rand() % cfg->colors) + 1;
+
+    pinMode(cfg->gpio, st->green, OUTPUT);
+    pinMode(cfg->gpio, st->red, OUTPUT);
+    pinMode(cfg->gpio, st->button, INPUT);
+    leds |= (1u << st->green) | (1u << st->red);
+    buttons |= 1u << st->button;
+  }
+  writePins(cfg->gpio, 0, leds);
+
+  // one sampler for all buttons; edge events of the GPIO chip would need a line request per button
+  if (inputStart(cfg->gpio, buttons, cfg->rateHz, onInputEvents) != 0)
+    failure(TRUE, "station: Unable to start sampling the buttons: %s\n", strerror(errno));
+
+  for (int i = 0; i < n; i++)
+  {
+    stations[i].startT = clockNow();
+    startRound(&stations[i]);
+  }
+
+  while (!allDone())
+    loopRunOnce(-1);
+  for (int i = 0; i < n; i++)
+    ledWait(&stations[i].leds);
+  writePins(cfg->gpio, 0, leds);
+
+  for (int i = 0; i < n; i++)
+  {
+    struct station *st = &stations[i];
+    fprintf(stdout, "Station %d: %s after %d rounds, %.3f s\n", i + 1, st->found ? "SUCCESS" : "sequence not found",
+            st->round, (st->endT - st->startT) / 1e6);
+    found += st->found;
+  }
+
+  return found;
+}
@@ -0,0 +1,64 @@
+/* ***************************************************************************** */
+/* Game stations (option -N): several players, each with a green LED, a red LED  */
+/* and a button of their own, play at once on one GPIO mapping. A station is a   */
+/* state machine driven by the event loop: one sampler reads all buttons, each   */
+/* station has its own digit decoder, deadline timer and LED sequencer, and no   */
+/* station ever waits for another.                                               */
+/* ***************************************************************************** */
+
+#ifndef MM_STATION_H
+#define MM_STATION_H
+
+#include <stdint.h>
+
+#include "mm-decode.h"
+#include "mm-led.h"
+#include "mm-score.h"
+
+// largest number of stations
+#define MAX_STATIONS 4
+// a station's game ends after this many rounds without a match
+#define MAX_ROUNDS 5
+
+/* BCM pins of the stations: green LED, red LED, button; station 1 is wired like */
+/* the single game, the others avoid the pins of the LCD (mm-lcd.h)              */
+extern const int stationPins[MAX_STATIONS][3];
+
+/* where a station is in its game */
+enum stationState
+{
+  ST_WAIT,  // waiting for the first press of a digit
+  ST_INPUT, // a digit is being entered
+  ST_ECHO,  // the guess is in; its echo plays out before the feedback
+  ST_DONE   // the game is over, guessed or not
+};
+
+struct station
+{
+  int id;
+  int green, red, button;
+  int secret[MAX_SEQL], guess[MAX_SEQL];
+  int round, digit, found;
+  enum stationState state;
+  struct ledSeq leds;
+  struct decoder dec;
+  int timer;          // loop timer for the decoder's deadline, -1 if none
+  uint64_t inputFrom; // presses sampled before the digit started don't count
+  uint64_t startT, endT;
+};
+
+/* settings shared by all stations */
+struct stationConfig
+{
+  uint32_t *gpio;
+  int seqlen, colors;
+  score_fn score;
+  int blink;  // classic blink feedback, the default, instead of PWM brightness (-F pwm)
+  int rateHz; // button sampling rate
+};
+
+/* play @n@ stations to the end, with the secret @secret@, or a random one each if */
+/* it is NULL; returns the number of stations that guessed their secret             */
+int stationsRun(const struct stationConfig *cfg, int n, const int *secret);
+
+#endif
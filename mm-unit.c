@@ -0,0 +1,90 @@
+/* ***************************************************************************** */
+/* In-process unit tests of the matching function, see option -t.                */
+/*                                                                               */
+/* The case file has one case per line: secret, guess, expected exact and        */
+/* approximate matches, e.g. "123 321 1 2". Blank lines and lines starting with  */
+/* '#' are ignored. All cases run in one process against countMatches().         */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "mm-score.h"
+
+#ifndef TRUE
+#define TRUE (1 == 1)
+#define FALSE (1 == 2)
+#endif
+
+int failure(int fatal, const char *message, ...);
+
+/* turn the digit string @str@ into a sequence of length @len@; 0 if it has another */
+/* length, or a digit that is no colour 1..@cols@                                    */
+static int parseCase(int *seq, const char *str, int len, int cols)
+{
+  if ((int)strlen(str) != len)
+    return 0;
+
+  for (int i = 0; i < len; i++)
+  {
+    if (str[i] < '1' || str[i] > '0' + cols)
+      return 0;
+    seq[i] = str[i] - '0';
+  }
+
+  return 1;
+}
+
+/* run all cases in @path@ against @countMatches@, for sequences of length @len@ */
+/* of @cols@ colours; prints every failing case and a summary, and returns the  */
+/* number of failures                                                           */
+int runUnitTests(const char *path, int *(*countMatches)(int *, int *), int len, int cols)
+{
+  FILE *f = fopen(path, "r");
+  char buf[256], str1[64], str2[64];
+  int seq1[MAX_SEQL], seq2[MAX_SEQL];
+  int exact, approx, line = 0, n = 0, ok = 0;
+  struct timespec t1, t2;
+
+  if (f == NULL)
+    failure(TRUE, "unit: unable to open %s: %s\n", path, strerror(errno));
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  while (fgets(buf, sizeof(buf), f) != NULL)
+  {
+    line++;
+    if (buf[strspn(buf, " \t\r\n")] == '\0' || buf[strspn(buf, " \t")] == '#')
+      continue;
+    if (sscanf(buf, "%63s %63s %d %d", str1, str2, &exact, &approx) != 4 ||
+        !parseCase(seq1, str1, len, cols) || !parseCase(seq2, str2, len, cols))
+    {
+      fprintf(stdout, "%s:%d: malformed case: %s", path, line, buf);
+      n++;
+      continue;
+    }
+
+    int *res = countMatches(seq1, seq2);
+    n++;
+    if (res[0] == exact && res[1] == approx)
+    {
+      ok++;
+    }
+    else
+    {
+      fprintf(stdout, "%s:%d: ** WRONG: %s %s\n", path, line, str1, str2);
+      fprintf(stdout, "  Output:   %d exact, %d approximate\n", res[0], res[1]);
+      fprintf(stdout, "  Expected: %d exact, %d approximate\n", exact, approx);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  fclose(f);
+
+  fprintf(stdout, "%d of %d tests are OK (%.3f ms)\n", ok, n,
+          (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6);
+
+  return n - ok;
+}
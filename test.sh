@@ -115,6 +115,59 @@ EOS
 )
 check
 
+# colours outside 1..3 are rejected, not scored
+cmd="./${cw} -u 145 451"
+out="`$cmd 2>&1`"
+exp=$(cat <<EOS
+Expected a sequence of 3 digits 1..3, not 145
+EOS
+)
+check
+
+# -------------------------------------------------------
+# whole games against the simulated hardware, in virtual time: every round is lost,
+# so the LED signals of all 5 rounds are queued, with blink feedback and with -F pwm
+
+cmd="./${cw} -S lose-script.txt -V -s 123"
+out="`$cmd 2>&1 | grep -e '^Round 5' -e 'not found' -e '^led:'`"
+exp=$(cat <<EOS
+Round 5
+Sequence not found
+EOS
+)
+check
+
+cmd="./${cw} -S lose-script.txt -V -c 3 -l 8 -s 12312312 -F pwm"
+out="`$cmd 2>&1 | grep -e '^Round 5' -e 'not found' -e '^led:'`"
+exp=$(cat <<EOS
+Round 5
+Sequence not found
+EOS
+)
+check
+
+cmd="./${cw} -S lose-script.txt -V -s 123 -N 2"
+out="`$cmd 2>&1 | grep -e 'round 5' -e 'not found' -e '^led:' | sed 's/,.*//' | sort`"
+exp=$(cat <<EOS
+Station 1: round 5
+Station 1: sequence not found after 5 rounds
+Station 2: round 5
+Station 2: sequence not found after 5 rounds
+EOS
+)
+check
+
+cmd="./${cw} -S lose-script.txt -V -c 3 -l 8 -s 12312312 -N 4 -F pwm"
+out="`$cmd 2>&1 | grep -e 'not found' -e '^led:' | sed 's/,.*//' | sort`"
+exp=$(cat <<EOS
+Station 1: sequence not found after 5 rounds
+Station 2: sequence not found after 5 rounds
+Station 3: sequence not found after 5 rounds
+Station 4: sequence not found after 5 rounds
+EOS
+)
+check
+
 # return status code (0 for ok, 1 for not)
 echo "$ok of $n tests are OK"
 exit $ret
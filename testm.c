@@ -1,9 +1,9 @@
 /*
-  A C program to test the matching function (for master-mind) as implemented in matches.s
+  A C program to test the matching function (for master-mind) as implemented in mm-score.c
 
-$ as  -o mm-matches.o mm-matches.s
+$ gcc -c -o mm-score.o mm-score.c
 $ gcc -c -o testm.o testm.c
-$ gcc -o testm testm.o matches.o
+$ gcc -o testm testm.o mm-score.o
 $ ./testm
 */
 
@@ -24,6 +24,12 @@ $ ./testm
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "mm-score.h"
+#include "mm-hint.h"
+#include "mm-index.h"
 
 #define LENGTH 3
 #define COLORS 3
@@ -31,8 +37,9 @@ $ ./testm
 #define NAN1 8
 #define NAN2 9
 
-const int seqlen = LENGTH;
-const int seqmax = COLORS;
+// defaults; change with -l and -c
+int seqlen = LENGTH;
+int seqmax = COLORS;
 
 /* ********************************** */
 /* take these fcts from master-mind.c */
@@ -52,38 +59,14 @@ void showSeq(int *seq)
 
 /* counts how many entries in seq2 match entries in seq1 */
 /* returns exact and approximate matches, either both encoded in one value, */
-/* or as a pointer to a pair of values */
+/* or as a pointer to a pair of values (owned by this fct, no allocation)  */
 int *countMatches_C(int *seq1, int *seq2)
 {
-  int *data = (int *)malloc(2 * sizeof(int));
-
-  data[0] = 0;
-  data[1] = 0;
+  static int data[2];
+  struct matches res = scoreMatches(seq1, seq2, seqlen, seqmax);
 
-  int approx = 0;
-  for (int i = 0; i < seqlen; i++)
-  {
-    if (seq1[i] == seq2[i])
-    {
-      if (seq2[i] == approx && data[1] != 0)
-      {
-        data[1]--;
-      }
-      data[0]++;
-    }
-
-    else
-    {
-      for (int j = 0; j < seqlen; j++)
-      {
-        if (seq1[i] == seq2[j] && i != j && seq2[j] != approx)
-        {
-          approx = seq2[j];
-          data[1]++;
-        }
-      }
-    }
-  }
+  data[0] = res.exact;
+  data[1] = res.approx;
 
   return data;
 }
@@ -127,121 +110,620 @@ int readNum(int max)
   return tmp;
 }
 
-// The ARM assembler version of the matching fct
+// The ARM assembler version of the matching fct (see mm-score.c);
+// on other platforms this is the kernel master-mind selects for the configuration
 int *countMatches(int *seq1, int *seq2)
 {
-  int *data = (int *)malloc(2 * sizeof(int)); // variable to store the matches
-
-  int res_exact = 0;
-  int res_approx = 0;
-
-  asm(
-      "start:\n"
-      "\tMOV R0, #0\n" // exact
-      "\tMOV R3, #0\n" // approx
-      "\tMOV R1, %[seq1]\n"
-      "\tMOV R2, %[seq2]\n"
-      "\tMOV R4, #0\n" // approx indicator
-      "\tMOV R5, #0\n" // length 1
-      "\tMOV R7, #0\n" // index 1
-      "\tMOV R6, #0\n" // length 2
-      "\tMOV R8, #0\n" // index 2
-      "\tB main_loop\n"
-
-      "main_loop:\n"
-      "\tCMP R5, #3\n"
-      "\tBEQ exit_routine\n"
-
-      "\tLDR R9, [R1, R7]\n"
-      "\tLDR R10, [R2, R7]\n"
-
-      "\tCMP R9, R10\n"
-      "\tBEQ add_exact\n"
-
-      "\tMOV R6, #0\n"
-      "\tMOV R8, #0\n"
-      "\rB approx_loop\n"
-      "\tB loop_increment1\n"
-
-      "loop_increment1:\n"
-      "\tADD R5, R5, #1\n"
-      "\tADD R7, R7, #4\n"
-      "\tB main_loop\n"
-
-      "add_exact:\n"
-      "\tADD R0, R0, #1\n"
-      "\tCMP R10, R4\n"
-      "\tBEQ check_approx_size\n"
-      "\tB loop_increment1\n"
-
-      "check_approx_size:\n"
-      "\tCMP R3, #0\n"
-      "\tBNE decrement_approx\n"
-      "\tB loop_increment1\n"
-
-      "decrement_approx:\n"
-      "\tSUB R3, R3, #1\n"
-      "\tB loop_increment1\n"
-
-      "approx_loop:\n"
-      "\tCMP R6, #3\n"
-      "\tBEQ loop_increment1\n"
-
-      "\tLDR R10, [R2, R8]\n"
-
-      "\tCMP R9, R10\n"
-      "\tBEQ index_check\n"
-      "\tB loop_increment2\n"
-
-      "loop_increment2:\n"
-      "\tADD R6, R6, #1\n"
-      "\tADD R8, R8, #4\n"
-      "\tB approx_loop\n"
-
-      "index_check:\n"
-      "\tCMP R5, R6\n"
-      "\tBNE approx_check\n"
-      "\tB loop_increment2\n"
-
-      "approx_check:\n"
-      "\tCMP R10, R4\n"
-      "\tBNE add_approx\n"
-      "\tB loop_increment2\n"
-
-      "add_approx:\n"
-      "\tMOV R4, R10\n"
-      "\tADD R3, R3, #1\n"
-      "\tMOV R6, #2\n"
-      "\tB loop_increment2\n"
-
-      "exit_routine:\n"
-      "\tMOV %[result_exact], R0\n"
-      "\tMOV %[result_approx], R3\n"
-
-      : [result_exact] "=r"(res_exact), [result_approx] "=r"(res_approx)
-      : [seq1] "r"(seq1), [seq2] "r"(seq2), [seqlen] "r"(seqlen)
-      : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "cc");
-
-  data[0] = res_exact;
-  data[1] = res_approx;
+  static int data[2];
+#if defined(__arm__)
+  return countMatches_asm(seq1, seq2, seqlen, data);
+#else
+  struct matches res = selectKernel(seqlen, seqmax)(seq1, seq2);
+
+  data[0] = res.exact;
+  data[1] = res.approx;
 
   return data;
+#endif
+}
+
+/* score every code of the code space against every other one with a batch kernel, */
+/* and compare each result with countMatches_C; returns the number of mismatches   */
+int testBatch(const char *name, batch_fn kernel)
+{
+  struct codeSet *set = codeSpaceSet(seqlen, seqmax);
+  unsigned char *out;
+  int *guess, *code, wrong = 0;
+
+  if (set == NULL)
+  {
+    fprintf(stderr, "Code space of %d colours and length %d is too large\n", seqmax, seqlen);
+    exit(EXIT_FAILURE);
+  }
+  out = (unsigned char *)malloc(set->n);
+  guess = (int *)malloc(seqlen * sizeof(int));
+  code = (int *)malloc(seqlen * sizeof(int));
+
+  for (int g = 0; g < set->n; g++)
+  {
+    indexToSeq(guess, g, seqlen, seqmax);
+    kernel(guess, set, out);
+    for (int k = 0; k < set->n; k++)
+    {
+      indexToSeq(code, k, seqlen, seqmax);
+      int *res_c = countMatches_C(code, guess);
+      if (UNPACK_EXACT(out[k], seqlen) != res_c[0] || UNPACK_APPROX(out[k], seqlen) != res_c[1])
+      {
+        if (wrong++ < 10)
+          fprintf(stdout, "** %s WRONG for codes %d and %d: %d %d, expected %d %d\n", name, k, g,
+                  UNPACK_EXACT(out[k], seqlen), UNPACK_APPROX(out[k], seqlen), res_c[0], res_c[1]);
+      }
+    }
+  }
+  fprintf(stderr, "%s: %d x %d pairs, %d WRONG\n", name, set->n, set->n, wrong);
+
+  free(code);
+  free(guess);
+  free(out);
+  freeCodeSet(set);
+  return wrong;
+}
+
+/* ------------------------------------------------------- */
+/* exhaustive differential verifier, option -x              */
+/* every (secret, guess) pair of the code space is scored   */
+/* by every registered kernel and compared with refMatches() */
+
+// number of mismatches printed per kernel and configuration
+#define MAX_REPORT 5
+// largest number of kernels that can be verified at once
+#define MAX_KERNELS 16
+
+/* reference result, independent of mm-score.c: the number of common pegs is */
+/* the sum over all colours of the smaller count in either sequence           */
+void refMatches(const int *seq1, const int *seq2, int len, int *exact, int *approx)
+{
+  int cnt1[MAX_COLS + 1] = {0}, cnt2[MAX_COLS + 1] = {0};
+  int common = 0;
+
+  *exact = 0;
+  for (int i = 0; i < len; i++)
+  {
+    if (seq1[i] == seq2[i])
+      (*exact)++;
+    cnt1[seq1[i]]++;
+    cnt2[seq2[i]]++;
+  }
+  for (int c = 0; c <= MAX_COLS; c++)
+    common += (cnt1[c] < cnt2[c]) ? cnt1[c] : cnt2[c];
+  *approx = common - *exact;
+}
+
+/* state shared by all worker threads, read-only while they run */
+static struct
+{
+  int len, cols, n;
+  int *seqs; // all codes of the code space, code k at seqs + k*len
+  struct codeSet *set;
+  const struct kernelInfo *kernels;
+  int nkernels;
+  const struct batchKernelInfo *batch;
+  int nbatch;
+  pthread_mutex_t lock; // protects wrong[] and the report
+  long wrong[2 * MAX_KERNELS];
+} vfy;
+
+struct verifyJob
+{
+  pthread_t thread;
+  int from, to; // range of guess indices
+  long pairs;
+};
+
+static void showCode(char *str, const int *seq, int len)
+{
+  for (int i = 0; i < len; i++)
+    str[i] = '0' + seq[i];
+  str[len] = '\0';
+}
+
+static void reportMismatch(int kernel, const char *name, const int *secret, const int *guess,
+                           int exact, int approx, int ref_exact, int ref_approx)
+{
+  char str1[MAX_SEQL + 1], str2[MAX_SEQL + 1];
+
+  pthread_mutex_lock(&vfy.lock);
+  if (vfy.wrong[kernel]++ < MAX_REPORT)
+  {
+    showCode(str1, secret, vfy.len);
+    showCode(str2, guess, vfy.len);
+    fprintf(stdout, "** %dx%d %s WRONG: %s %s gives %d %d, expected %d %d\n", vfy.cols, vfy.len, name,
+            str1, str2, exact, approx, ref_exact, ref_approx);
+  }
+  pthread_mutex_unlock(&vfy.lock);
+}
+
+static void *verifyWorker(void *arg)
+{
+  struct verifyJob *job = (struct verifyJob *)arg;
+  int len = vfy.len, n = vfy.n;
+  int *ref = (int *)malloc(2 * n * sizeof(int));
+  unsigned char *out = (unsigned char *)malloc(n);
+
+  for (int g = job->from; g < job->to; g++)
+  {
+    const int *guess = vfy.seqs + g * len;
+
+    for (int s = 0; s < n; s++)
+      refMatches(vfy.seqs + s * len, guess, len, &ref[2 * s], &ref[2 * s + 1]);
+
+    for (int k = 0; k < vfy.nkernels; k++)
+    {
+      if (!vfy.kernels[k].available)
+        continue;
+      for (int s = 0; s < n; s++)
+      {
+        struct matches res = vfy.kernels[k].fn(vfy.seqs + s * len, guess);
+        if (res.exact != ref[2 * s] || res.approx != ref[2 * s + 1])
+          reportMismatch(k, vfy.kernels[k].name, vfy.seqs + s * len, guess,
+                         res.exact, res.approx, ref[2 * s], ref[2 * s + 1]);
+      }
+      job->pairs += n;
+    }
+
+    for (int k = 0; k < vfy.nbatch; k++)
+    {
+      if (!vfy.batch[k].available)
+        continue;
+      vfy.batch[k].fn(guess, vfy.set, out);
+      for (int s = 0; s < n; s++)
+      {
+        if (UNPACK_EXACT(out[s], len) != ref[2 * s] || UNPACK_APPROX(out[s], len) != ref[2 * s + 1])
+          reportMismatch(MAX_KERNELS + k, vfy.batch[k].name, vfy.seqs + s * len, guess,
+                         UNPACK_EXACT(out[s], len), UNPACK_APPROX(out[s], len), ref[2 * s], ref[2 * s + 1]);
+      }
+      job->pairs += n;
+    }
+  }
+
+  free(out);
+  free(ref);
+  return NULL;
+}
+
+/* verify all kernels on the whole code space of @cols@ colours and length @len@, */
+/* split over @nthreads@ threads; returns the number of mismatches                */
+long verifyConfig(int len, int cols, int nthreads)
+{
+  struct verifyJob job[nthreads];
+  struct timespec t1, t2;
+  long pairs = 0, wrong = 0;
+  double secs;
+
+  if (bindKernel(len, cols) == NULL || (vfy.set = codeSpaceSet(len, cols)) == NULL)
+  {
+    fprintf(stderr, "Code space of %d colours and length %d is too large\n", cols, len);
+    exit(EXIT_FAILURE);
+  }
+  vfy.len = len;
+  vfy.cols = cols;
+  vfy.n = vfy.set->n;
+  vfy.seqs = (int *)malloc((size_t)vfy.n * len * sizeof(int));
+  for (int k = 0; k < vfy.n; k++)
+    indexToSeq(vfy.seqs + k * len, k, len, cols);
+  vfy.kernels = scoreKernelList(&vfy.nkernels);
+  vfy.batch = batchKernelList(&vfy.nbatch);
+  memset(vfy.wrong, 0, sizeof(vfy.wrong));
+  pthread_mutex_init(&vfy.lock, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  for (int t = 0; t < nthreads; t++)
+  {
+    job[t].from = (int)((long)vfy.n * t / nthreads);
+    job[t].to = (int)((long)vfy.n * (t + 1) / nthreads);
+    job[t].pairs = 0;
+    pthread_create(&job[t].thread, NULL, verifyWorker, &job[t]);
+  }
+  for (int t = 0; t < nthreads; t++)
+  {
+    pthread_join(job[t].thread, NULL);
+    pairs += job[t].pairs;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  secs = (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+
+  for (int k = 0; k < 2 * MAX_KERNELS; k++)
+    wrong += vfy.wrong[k];
+  fprintf(stderr, "%dx%d: %d x %d pairs, %ld checks, %ld WRONG (%.3f s, %.1f Mpairs/s on %d threads)\n",
+          cols, len, vfy.n, vfy.n, pairs, wrong, secs, pairs / secs / 1e6, nthreads);
+
+  pthread_mutex_destroy(&vfy.lock);
+  free(vfy.seqs);
+  freeCodeSet(vfy.set);
+  return wrong;
+}
+
+/* ------------------------------------------------------- */
+/* hint engine, option -H                                   */
+/* games are played with the suggestions of mm-hint.c, and  */
+/* after every round the codes left are counted afresh; it  */
+/* prunes with the batch kernel, then through an index of   */
+/* each layout that was saved to a file and mapped back in  */
+
+// largest number of secrets played; larger code spaces are sampled
+#define HINT_GAMES 1296
+
+/* number of codes that give the same feedback as @secret@ for all @rounds@ guesses */
+static int refConsistent(const int *guesses, const int *secret, int rounds, int len, int cols, int n)
+{
+  int code[MAX_SEQL], left = 0;
+
+  for (int k = 0; k < n; k++)
+  {
+    int r;
+
+    indexToSeq(code, k, len, cols);
+    for (r = 0; r < rounds; r++)
+    {
+      int e1, a1, e2, a2;
+      refMatches(secret, guesses + r * len, len, &e1, &a1);
+      refMatches(code, guesses + r * len, len, &e2, &a2);
+      if (e1 != e2 || a1 != a2)
+        break;
+    }
+    left += (r == rounds);
+  }
+
+  return left;
+}
+
+/* play every secret of the code space, or HINT_GAMES random ones, always  */
+/* guessing the suggestion, pruning through @ix@ unless it is NULL; returns */
+/* the number of wrong counts and games that didn't end                     */
+int testHints(int len, int cols, const struct codeIndex *ix, const char *name)
+{
+  struct hint h;
+  struct timespec t1, t2, t3;
+  int guesses[MAX_SEQL * (MAX_SEQL + 1) * (MAX_SEQL + 1)], secret[MAX_SEQL];
+  int games, wrong = 0, maxRounds = 0;
+  long rounds = 0;
+  double suggestSecs = 0, pruneSecs = 0;
+
+  if (hintInit(&h, len, cols) != 0)
+  {
+    fprintf(stderr, "Code space of %d colours and length %d is too large\n", cols, len);
+    exit(EXIT_FAILURE);
+  }
+  if (ix != NULL)
+    hintUseIndex(&h, ix);
+  games = (h.n < HINT_GAMES) ? h.n : HINT_GAMES;
+  srand(1701);
+
+  for (int g = 0; g < games; g++)
+  {
+    int r = 0, e, a;
+
+    indexToSeq(secret, (games == h.n) ? g : rand() % h.n, len, cols);
+    hintReset(&h);
+    do
+    {
+      int *guess = guesses + r * len;
+
+      // every feedback splits the codes left, so a game can't take more rounds than there are feedbacks
+      if (r == (len + 1) * (len + 1))
+      {
+        wrong++;
+        break;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      hintSuggest(&h, guess);
+      refMatches(secret, guess, len, &e, &a);
+      clock_gettime(CLOCK_MONOTONIC, &t2);
+      hintUpdate(&h, guess, e, a);
+      clock_gettime(CLOCK_MONOTONIC, &t3);
+      suggestSecs += (t2.tv_sec - t1.tv_sec) + (t2.tv_nsec - t1.tv_nsec) / 1e9;
+      pruneSecs += (t3.tv_sec - t2.tv_sec) + (t3.tv_nsec - t2.tv_nsec) / 1e9;
+      r++;
+
+      if (!hintConsistent(&h, secret) || h.count != refConsistent(guesses, secret, r, len, cols, h.n))
+      {
+        if (wrong++ < MAX_REPORT)
+          fprintf(stdout, "** hint WRONG after round %d: %d codes left, expected %d\n", r, h.count,
+                  refConsistent(guesses, secret, r, len, cols, h.n));
+        break;
+      }
+    } while (e != len);
+
+    rounds += r;
+    if (r > maxRounds)
+      maxRounds = r;
+  }
+
+  fprintf(stderr, "%dx%d %s: %d games, %.2f rounds on average, %d at most; per round %.1f us to suggest, %.2f us to prune; %d WRONG\n",
+          cols, len, name, games, (double)rounds / games, maxRounds, suggestSecs * 1e6 / rounds, pruneSecs * 1e6 / rounds, wrong);
+
+  hintFree(&h);
+  return wrong;
+}
+
+/* build the index of @layout@, round-trip it through a file, and play with it; */
+/* a sparse one must no longer load once an offset is damaged; returns the      */
+/* number of errors, none if the index is too large for @layout@                */
+int testIndex(int len, int cols, enum indexLayout layout)
+{
+  const char *name = (layout == INDEX_DENSE) ? "dense index" : "sparse index";
+  char path[] = "/tmp/mm-index-XXXXXX";
+  struct codeIndex ix;
+  int fd, wrong;
+
+  if (indexBuildLayout(&ix, len, cols, layout) != 0)
+  {
+    fprintf(stderr, "%dx%d %s: too large, skipped\n", cols, len, name);
+    return 0;
+  }
+  if ((fd = mkstemp(path)) < 0 || indexSave(&ix, path) != 0)
+  {
+    fprintf(stdout, "** %s: unable to save to %s: %s\n", name, path, strerror(errno));
+    indexFree(&ix);
+    return 1;
+  }
+  close(fd);
+  indexFree(&ix);
+
+  if (indexLoad(&ix, path, len, cols) != 0)
+  {
+    fprintf(stdout, "** %s: unable to map %s: %s\n", name, path, strerror(errno));
+    unlink(path);
+    return 1;
+  }
+  wrong = testHints(len, cols, &ix, name);
+
+  if (layout == INDEX_SPARSE)
+  { // an offset past the end of the codes of its guess
+    uint32_t bad = (uint32_t)ix.n * ix.n;
+    off_t at = (const char *)(ix.offsets + 1) - (const char *)ix.mem;
+    struct codeIndex damaged;
+
+    if ((fd = open(path, O_WRONLY)) < 0 || pwrite(fd, &bad, sizeof(bad), at) != (ssize_t)sizeof(bad))
+    {
+      fprintf(stdout, "** %s: unable to damage %s: %s\n", name, path, strerror(errno));
+      wrong++;
+    }
+    else if (indexLoad(&damaged, path, len, cols) == 0)
+    {
+      fprintf(stdout, "** %s: a damaged offset was not detected\n", name);
+      indexFree(&damaged);
+      wrong++;
+    }
+    if (fd >= 0)
+      close(fd);
+  }
+  unlink(path);
+  indexFree(&ix);
+  return wrong;
+}
+
+/* ------------------------------------------------------- */
+/* microbenchmark, option -m                                */
+/* every kernel runs over the same pre-generated pairs, in  */
+/* blocks of BENCH_BLOCK calls that are timed individually  */
+
+// number of random pairs the kernels are run over
+#define BENCH_PAIRS (1 << 16)
+// calls per timed block; one clock read costs about as much as a few calls
+#define BENCH_BLOCK 64
+// runs over all pairs, not counting the warm-up runs
+#define BENCH_REPS 20
+#define BENCH_WARMUP 3
+// codes per call of a batch kernel
+#define BENCH_CODES 4096
+
+struct benchResult
+{
+  const char *kind, *name;
+  double ns, cycles; // per op; cycles < 0 if there is no cycle counter
+  double p50, p99;   // per op, over all timed blocks
+  long ops;
+};
+
+static uint64_t nowNsRaw(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* open the CPU cycle counter of this thread via perf_event; -1 if not available */
+static int openCycleCounter(void)
+{
+  struct perf_event_attr pe;
+
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_HARDWARE;
+  pe.size = sizeof(pe);
+  pe.config = PERF_COUNT_HW_CPU_CYCLES;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+
+  return (int)syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+}
+
+static uint64_t readCycles(int fd)
+{
+  uint64_t cycles = 0;
+
+  if (fd < 0 || read(fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+    return 0;
+  return cycles;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* fill in the percentiles of the per-op block times in @samples@ */
+static void percentiles(struct benchResult *r, double *samples, int n)
+{
+  qsort(samples, n, sizeof(double), cmpDouble);
+  r->p50 = samples[n / 2];
+  r->p99 = samples[(int)(n * 0.99)];
+}
+
+static void benchScore(struct benchResult *r, score_fn fn, const int *seqs, int cycleFd)
+{
+  int blocks = BENCH_PAIRS / BENCH_BLOCK, nsamples = 0;
+  double *samples = (double *)malloc((size_t)BENCH_REPS * blocks * sizeof(double));
+  volatile int sink = 0;
+  uint64_t ns = 0, cycles = 0;
+
+  for (int rep = 0; rep < BENCH_WARMUP + BENCH_REPS; rep++)
+  {
+    uint64_t c0 = readCycles(cycleFd), t0 = nowNsRaw();
+    for (int b = 0; b < blocks; b++)
+    {
+      uint64_t b0 = nowNsRaw();
+      for (int i = b * BENCH_BLOCK; i < (b + 1) * BENCH_BLOCK; i++)
+        sink += fn(seqs + 2 * i * seqlen, seqs + (2 * i + 1) * seqlen).exact;
+      if (rep >= BENCH_WARMUP)
+        samples[nsamples++] = (double)(nowNsRaw() - b0) / BENCH_BLOCK;
+    }
+    if (rep >= BENCH_WARMUP)
+    {
+      ns += nowNsRaw() - t0;
+      cycles += readCycles(cycleFd) - c0;
+    }
+  }
+
+  r->ops = (long)BENCH_REPS * BENCH_PAIRS;
+  r->ns = (double)ns / r->ops;
+  r->cycles = (cycleFd < 0) ? -1.0 : (double)cycles / r->ops;
+  percentiles(r, samples, nsamples);
+  free(samples);
+}
+
+/* an op of a batch kernel is one scored code; each call is one timed block */
+static void benchBatch(struct benchResult *r, batch_fn fn, const struct codeSet *set, const int *seqs, int cycleFd)
+{
+  int calls = BENCH_PAIRS / set->n, nsamples = 0;
+  double *samples = (double *)malloc((size_t)BENCH_REPS * calls * sizeof(double));
+  unsigned char *out = (unsigned char *)malloc(set->n);
+  uint64_t ns = 0, cycles = 0;
+
+  for (int rep = 0; rep < BENCH_WARMUP + BENCH_REPS; rep++)
+  {
+    uint64_t c0 = readCycles(cycleFd), t0 = nowNsRaw();
+    for (int c = 0; c < calls; c++)
+    {
+      uint64_t b0 = nowNsRaw();
+      fn(seqs + c * seqlen, set, out);
+      if (rep >= BENCH_WARMUP)
+        samples[nsamples++] = (double)(nowNsRaw() - b0) / set->n;
+    }
+    if (rep >= BENCH_WARMUP)
+    {
+      ns += nowNsRaw() - t0;
+      cycles += readCycles(cycleFd) - c0;
+    }
+  }
+
+  r->ops = (long)BENCH_REPS * calls * set->n;
+  r->ns = (double)ns / r->ops;
+  r->cycles = (cycleFd < 0) ? -1.0 : (double)cycles / r->ops;
+  percentiles(r, samples, nsamples);
+  free(out);
+  free(samples);
+}
+
+/* benchmark all available kernels for the current configuration, and print */
+/* one record per kernel as CSV or (if @json@) as a JSON array                */
+void runBenchmark(int json)
+{
+  const struct kernelInfo *kernels;
+  const struct batchKernelInfo *batch;
+  struct benchResult res[2 * MAX_KERNELS];
+  int nkernels, nbatch, nres = 0;
+  int cycleFd = openCycleCounter();
+  int *seqs = (int *)malloc((size_t)BENCH_PAIRS * 2 * seqlen * sizeof(int));
+  struct codeSet *set = newCodeSet(BENCH_CODES, seqlen, seqmax);
+
+  if (bindKernel(seqlen, seqmax) == NULL)
+  {
+    fprintf(stderr, "Expected 2..%d colours and a length of 1..%d\n", MAX_COLS, MAX_SEQL);
+    exit(EXIT_FAILURE);
+  }
+  if (cycleFd < 0)
+    fprintf(stderr, "No cycle counter available (perf_event_open: %s)\n", strerror(errno));
+
+  srand(1701);
+  for (int i = 0; i < BENCH_PAIRS * 2 * seqlen; i++)
+    seqs[i] = rand() % seqmax + 1;
+  for (int k = 0; k < BENCH_CODES; k++)
+    setCode(set, k, seqs + k * seqlen);
+
+  kernels = scoreKernelList(&nkernels);
+  for (int k = 0; k < nkernels; k++)
+  {
+    if (!kernels[k].available)
+      continue;
+    res[nres].kind = "score";
+    res[nres].name = kernels[k].name;
+    benchScore(&res[nres++], kernels[k].fn, seqs, cycleFd);
+  }
+  batch = batchKernelList(&nbatch);
+  for (int k = 0; k < nbatch; k++)
+  {
+    if (!batch[k].available)
+      continue;
+    res[nres].kind = "batch";
+    res[nres].name = batch[k].name;
+    benchBatch(&res[nres++], batch[k].fn, set, seqs, cycleFd);
+  }
+
+  if (json)
+    fprintf(stdout, "[\n");
+  else
+    fprintf(stdout, "kind,kernel,colours,length,ops,ns_per_op,cycles_per_op,p50_ns,p99_ns\n");
+  for (int i = 0; i < nres; i++)
+  {
+    struct benchResult *r = &res[i];
+    char cycles[32] = "";
+    if (r->cycles >= 0)
+      snprintf(cycles, sizeof(cycles), "%.2f", r->cycles);
+    if (json)
+      fprintf(stdout, "  {\"kind\": \"%s\", \"kernel\": \"%s\", \"colours\": %d, \"length\": %d, \"ops\": %ld, "
+                      "\"ns_per_op\": %.3f, \"cycles_per_op\": %s, \"p50_ns\": %.3f, \"p99_ns\": %.3f}%s\n",
+              r->kind, r->name, seqmax, seqlen, r->ops, r->ns, r->cycles >= 0 ? cycles : "null",
+              r->p50, r->p99, i + 1 < nres ? "," : "");
+    else
+      fprintf(stdout, "%s,%s,%d,%d,%ld,%.3f,%s,%.3f,%.3f\n", r->kind, r->name, seqmax, seqlen, r->ops,
+              r->ns, cycles, r->p50, r->p99);
+  }
+  if (json)
+    fprintf(stdout, "]\n");
+
+  if (cycleFd >= 0)
+    close(cycleFd);
+  freeCodeSet(set);
+  free(seqs);
 }
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 int main(int argc, char **argv)
 {
-  int *res, *res_c, t, t_c, m, n;
+  int *res, *res_c, m, n;
   int *seq1, *seq2, *cpy1, *cpy2;
-  struct timeval t1, t2;
+  uint64_t t, t_c, t1;
   char str_in[20], str[20] = "some text";
-  int verbose = 0, debug = 0, help = 0, opt_s = 0, opt_n = 0;
+  int verbose = 0, debug = 0, help = 0, opt_s = 0, opt_n = 0, opt_b = 0, opt_x = 0, opt_cl = 0, opt_m = 0, opt_H = 0;
+  char *opt_o = "csv";
 
   // see: man 3 getopt for docu and an example of command line parsing
   { // see the CW spec for the intended meaning of these options
     int opt;
-    while ((opt = getopt(argc, argv, "hvs:n:")) != -1)
+    while ((opt = getopt(argc, argv, "hvdBxmHs:n:c:l:o:")) != -1)
     {
       switch (opt)
       {
@@ -260,13 +742,85 @@ int main(int argc, char **argv)
       case 'n':
         opt_n = atoi(optarg);
         break;
+      case 'B':
+        opt_b = 1;
+        break;
+      case 'x':
+        opt_x = 1;
+        break;
+      case 'm':
+        opt_m = 1;
+        break;
+      case 'H':
+        opt_H = 1;
+        break;
+      case 'o':
+        opt_o = optarg;
+        break;
+      case 'c':
+        seqmax = atoi(optarg);
+        opt_cl = 1;
+        break;
+      case 'l':
+        seqlen = atoi(optarg);
+        opt_cl = 1;
+        break;
       default: /* '?' */
-        fprintf(stderr, "Usage: %s [-h] [-v] [-s <seed>] [-n <no. of iterations>]  \n", argv[0]);
+        fprintf(stderr, "Usage: %s [-h] [-v] [-s <seed>] [-n <no. of iterations>] [-c <colours>] [-l <length>] [-B] [-x] [-H] [-m [-o csv|json]]  \n", argv[0]);
         exit(EXIT_FAILURE);
       }
     }
   }
 
+  if (seqmax < 2 || seqmax > MAX_COLS || seqlen < 1 || seqlen > MAX_SEQL)
+  {
+    fprintf(stderr, "Expected 2..%d colours and a length of 1..%d\n", MAX_COLS, MAX_SEQL);
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_b)
+  { // compare all batch kernels against countMatches_C on the whole code space
+    int wrong = testBatch("scalar", countMatchesBatch_scalar);
+#if defined(__x86_64__)
+    wrong += testBatch("sse2", countMatchesBatch_sse2);
+    if (__builtin_cpu_supports("avx2"))
+      wrong += testBatch("avx2", countMatchesBatch_avx2);
+#endif
+#if defined(__ARM_NEON)
+    wrong += testBatch("neon", countMatchesBatch_neon);
+#endif
+    exit(wrong == 0 ? 0 : 1);
+  }
+
+  if (opt_H)
+  { // play games with the hint engine's suggestions, and check its count of the codes left, with and without index
+    int wrong = testHints(seqlen, seqmax, NULL, "scored");
+    wrong += testIndex(seqlen, seqmax, INDEX_DENSE);
+    wrong += testIndex(seqlen, seqmax, INDEX_SPARSE);
+    exit(wrong == 0 ? 0 : 1);
+  }
+
+  if (opt_m)
+  { // microbenchmark of all kernels, machine-readable output
+    runBenchmark(strcmp(opt_o, "json") == 0);
+    exit(EXIT_SUCCESS);
+  }
+
+  if (opt_x)
+  { // verify all kernels on every pair, for the given configuration or all up to 6x4
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long wrong = 0;
+    if (nthreads < 1)
+      nthreads = 1;
+    if (opt_cl)
+      wrong = verifyConfig(seqlen, seqmax, nthreads);
+    else
+      for (int c = 2; c <= 6; c++)
+        for (int l = 1; l <= 4; l++)
+          wrong += verifyConfig(l, c, nthreads);
+    exit(wrong == 0 ? 0 : 1);
+  }
+
   seq1 = (int *)malloc(seqlen * sizeof(int));
   seq2 = (int *)malloc(seqlen * sizeof(int));
   cpy1 = (int *)malloc(seqlen * sizeof(int));
@@ -294,8 +848,8 @@ int main(int argc, char **argv)
     {
       for (j = 0; j < seqlen; j++)
       {
-        seq1[j] = (rand() % seqlen + 1);
-        seq2[j] = (rand() % seqlen + 1);
+        seq1[j] = (rand() % seqmax + 1);
+        seq2[j] = (rand() % seqmax + 1);
       }
       memcpy(cpy1, seq1, seqlen * sizeof(int));
       memcpy(cpy2, seq2, seqlen * sizeof(int));
@@ -344,14 +898,9 @@ int main(int argc, char **argv)
   memcpy(seq1, cpy1, seqlen * sizeof(int));
   memcpy(seq2, cpy2, seqlen * sizeof(int));
 
-  gettimeofday(&t1, NULL);
+  t1 = nowNsRaw();
   res_c = countMatches_C(seq1, seq2); // local C function
-  gettimeofday(&t2, NULL);
-  // d = difftime(t1,t2);
-  if (t2.tv_usec < t1.tv_usec) // Counter wrapped
-    t_c = (1000000 + t2.tv_usec) - t1.tv_usec;
-  else
-    t_c = t2.tv_usec - t1.tv_usec;
+  t_c = nowNsRaw() - t1;
 
   if (debug)
   {
@@ -362,14 +911,9 @@ int main(int argc, char **argv)
   memcpy(seq1, cpy1, seqlen * sizeof(int));
   memcpy(seq2, cpy2, seqlen * sizeof(int));
 
-  gettimeofday(&t1, NULL);
-  res = countMatches(seq1, seq2); // extern; code in hamming4.s
-  gettimeofday(&t2, NULL);
-  // d = difftime(t1,t2);
-  if (t2.tv_usec < t1.tv_usec) // Counter wrapped
-    t = (1000000 + t2.tv_usec) - t1.tv_usec;
-  else
-    t = t2.tv_usec - t1.tv_usec;
+  t1 = nowNsRaw();
+  res = countMatches(seq1, seq2); // extern; code in mm-score.c
+  t = nowNsRaw() - t1;
 
   if (debug)
   {
@@ -383,7 +927,7 @@ int main(int argc, char **argv)
   showMatches(res_c, seq1, seq2, 0);
   showMatches(res, seq1, seq2, 0);
 
-  if (res[0] == res_c[0] && res[1] == res[1])
+  if (res[0] == res_c[0] && res[1] == res_c[1])
   {
     fprintf(stdout, "__ result OK\n");
   }
@@ -391,8 +935,8 @@ int main(int argc, char **argv)
   {
     fprintf(stdout, "** result WRONG\n");
   }
-  fprintf(stderr, "C   version:\t\tresult=%d %d (elapsed time: %dms)\n", res_c[0], res_c[1], t_c);
-  fprintf(stderr, "Asm version:\t\tresult=%d %d (elapsed time: %dms)\n", res[0], res[1], t);
+  fprintf(stderr, "C   version:\t\tresult=%d %d (elapsed time: %luns; single call, see -m for a benchmark)\n", res_c[0], res_c[1], (unsigned long)t_c);
+  fprintf(stderr, "Asm version:\t\tresult=%d %d (elapsed time: %luns; single call, see -m for a benchmark)\n", res[0], res[1], (unsigned long)t);
 
   return 0;
 }